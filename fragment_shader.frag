@@ -1,12 +1,35 @@
 #version 400 core
+// Exponent d of z -> z^d + c (2 for the Mandelbrot set), fixed when the shader
+// is compiled so the power loop unrolls and the z^2 case keeps its short form
+#define POWER 2
 out vec4 FragColor;
 in vec2 TexCoord;
 
 uniform sampler1D colormap;
-uniform sampler2D complexSet;
+// View transform: center, real/imaginary extent and (cos, sin) of the
+// rotation. Pixel coordinates are derived from gl_FragCoord, so no per-pixel
+// coordinate data is uploaded.
+uniform vec2 view_center;
+// Rounding error of view_center (the exact center is view_center +
+// view_center_lo), only read in float-float mode
+uniform vec2 view_center_lo;
+uniform vec2 view_extent;
+uniform vec2 view_rotation;
+uniform vec2 resolution;
 
 uniform int n_iterations;
 uniform float threshold;
+// Continuous count constants computed by the host, see SmoothCountScale on
+// the CPU: 0.5 / log2(threshold) and 1 / log2(POWER)
+uniform float norm_scale;
+uniform float power_scale;
+// Skip the main cardioid and period-2 bulb (known interior) when set
+uniform bool interior_check;
+// Orbits closing within this distance are declared interior, 0 disables
+uniform float periodicity_tolerance;
+// Iterate in emulated float-float instead of float, for zooms past the
+// resolution of float. Chosen by the host from the pixel spacing.
+uniform bool float_float;
 
 
 vec2 complexMul(vec2 a, vec2 b) {
@@ -16,57 +39,230 @@ vec2 complexMul(vec2 a, vec2 b) {
 }
 
 vec2 mandelbrotFunc(vec2 z_val, vec2 complex_val) {
-    return vec2(complexMul(z_val, z_val) + complex_val);
+#if POWER == 2
+    return complexMul(z_val, z_val) + complex_val;
+#else
+    vec2 z_power = z_val;
+    for (int i = 1; i < POWER; i++) {
+        z_power = complexMul(z_power, z_val);
+    }
+    return z_power + complex_val;
+#endif
+}
+
+// Offset of the pixel center at fragCoord from the view center
+vec2 pixelOffset(vec2 fragCoord) {
+    vec2 offset = (fragCoord / resolution - 0.5) * view_extent;
+    return vec2(offset.x * view_rotation.x - offset.y * view_rotation.y,
+        offset.x * view_rotation.y + offset.y * view_rotation.x);
+}
+
+// Complex coordinate of the pixel center at fragCoord
+vec2 pixelToComplex(vec2 fragCoord) {
+    return view_center + pixelOffset(fragCoord);
+}
+
+// Float-float arithmetic: a value is the unevaluated sum x + y of two floats,
+// about 44 significant bits. Everything is `precise` so the compiler keeps the
+// rounding error terms instead of simplifying them to zero.
+
+// a + b = s + err exactly
+vec2 ffTwoSum(float a, float b) {
+    precise float s = a + b;
+    precise float bb = s - a;
+    precise float err = (a - (s - bb)) + (b - bb);
+    return vec2(s, err);
+}
+
+// Same as ffTwoSum, requires |a| >= |b|
+vec2 ffQuickTwoSum(float a, float b) {
+    precise float s = a + b;
+    precise float err = b - (s - a);
+    return vec2(s, err);
 }
 
+// a * b = p + err exactly, with Dekker's split instead of a fused multiply-add,
+// which not every GPU evaluates exactly
+vec2 ffTwoProd(float a, float b) {
+    precise float p = a * b;
+    precise float ta = 4097.0 * a;
+    precise float aHi = ta - (ta - a);
+    precise float aLo = a - aHi;
+    precise float tb = 4097.0 * b;
+    precise float bHi = tb - (tb - b);
+    precise float bLo = b - bHi;
+    precise float err = ((aHi * bHi - p) + aHi * bLo + aLo * bHi) + aLo * bLo;
+    return vec2(p, err);
+}
 
-// coonsider using nonlinear (e.g., logarithmic) scale
-vec3 computeColorIteration(int iter) {
-    vec3 color;
-    if (iter == n_iterations) {
-        // last iteration - always black color
-        color = vec3(0.0, 0.0, 0.0);
+vec2 ffAdd(vec2 a, vec2 b) {
+    precise vec2 s = ffTwoSum(a.x, b.x);
+    precise vec2 t = ffTwoSum(a.y, b.y);
+    s.y += t.x;
+    s = ffQuickTwoSum(s.x, s.y);
+    s.y += t.y;
+    return ffQuickTwoSum(s.x, s.y);
+}
+
+vec2 ffMul(vec2 a, vec2 b) {
+    precise vec2 p = ffTwoProd(a.x, b.x);
+    p.y += a.x * b.y + a.y * b.x;
+    return ffQuickTwoSum(p.x, p.y);
+}
+
+// Closed-form membership test for the main cardioid and the period-2 bulb
+bool inCardioidOrBulb(vec2 c) {
+    float y2 = c.y * c.y;
+    float xq = c.x - 0.25;
+    float q = xq * xq + y2;
+    if (q * (q + xq) <= 0.25 * y2) {
+        return true;
     }
-    else {
-        // important - cast to float before the divison
-
-        // version 1: linear scale, greyscale:
-//        float color_ = float(iter) / float(n_iterations);
-//        color = vec3(color_, color_, color_);
-
-        // version 2: log scale, greyscale:
-//         float color_ = log(float(iter)) / log(float(n_iterations));
-//         color = vec3(color_, color_, color_);
-
-        //version 3: log scale, colormap:
-        if (iter == n_iterations) {
-            // Points that are considered inside the Mandelbrot set
-            color = vec3(0.5, 0.5, 0.0); // Example: Change to a distinct color, e.g., orange
-        } else {
-            // Points that escape are colored based on the logarithmic scale
-            float color_ = log(float(iter)) / log(float(n_iterations));
-            color = texture(colormap, color_).rgb;
+    float xb = c.x + 1.0;
+    return xb * xb + y2 <= 0.0625;
+}
+
+
+// log2 of a positive finite float to within 2e-4, fastLog2 on the CPU: the
+// exponent bits plus a polynomial of the mantissa, no transcendental call
+float fastLog2(float x) {
+    int bits = floatBitsToInt(x);
+    float exponent = float(((bits >> 23) & 0xFF) - 127);
+    // Mantissa in [1, 2), the polynomial fits log2(1 + t) on [0, 1)
+    float t = intBitsToFloat((bits & 0x007FFFFF) | 0x3F800000) - 1.0;
+    return exponent + t * (1.4380732 + t * (-0.67476666 + t * (0.31700072 + t * -0.080307304)));
 }
+
+// Continuous (normalized) count of a pixel that escaped after iter steps with
+// |z|^2 = escape_norm, the formula of smoothIterationCount on the CPU:
+//     iter + 1 - log_d(log|z| / log R)
+// Like there the fraction stays below 1 (255/256, its last fixed-point
+// step), so an escaped pixel never reaches the interior count. Pixels that
+// did not escape stay at n_iterations.
+float smoothIteration(int iter, float escape_norm) {
+    if (iter >= n_iterations || !(escape_norm > 1.0)) {
+        return float(min(iter, n_iterations));
     }
-    return color;
+    float fraction = 1.0 - fastLog2(fastLog2(escape_norm) * norm_scale) * power_scale;
+    return float(iter) + clamp(fraction, 0.0, 255.0 / 256.0);
 }
 
-void main()
-{
-    // complex_val.x - real, complex_val.y - imag
-    vec2 complex_val = texture(complexSet, TexCoord).rg; // Assuming TexCoord is available
+// Color of a continuous count. colormap holds one texel per count
+// 0..n_iterations with the log scale already applied by the host, the two
+// texels around the count are blended so no bands show. As in smoothColor on
+// the CPU, escaped counts never blend into the interior texel.
+vec3 computeColorIteration(float iteration) {
+    int iter = clamp(int(iteration), 0, n_iterations);
+    int next = iter + 1 < n_iterations ? iter + 1 : iter;
+    vec3 low = texelFetch(colormap, iter, 0).rgb;
+    vec3 high = texelFetch(colormap, next, 0).rgb;
+    return mix(low, high, iteration - float(iter));
+}
+
+// Escape-time count in float, the same loop as the double shader. escape_norm
+// receives |z|^2 at escape.
+int iterateFloat(vec2 complex_val, out float escape_norm) {
+    escape_norm = 0.0;
+    if (POWER == 2 && interior_check && inCardioidOrBulb(complex_val)) {
+        return n_iterations;
+    }
 
     vec2 z_value_iterated = vec2(0.0, 0.0);
-    int iter = 0;
+    // Brent-style cycle detection against an orbit point saved at powers of two
+    vec2 z_saved = z_value_iterated;
+    int checkpoint = 1;
+    float threshold2 = threshold * threshold;
 
+    int iter = 0;
     for (iter; iter < n_iterations; iter++) {
         z_value_iterated = mandelbrotFunc(z_value_iterated, complex_val);
 
-        if (length(z_value_iterated) > threshold) {
+        // |z|^2 against the squared radius, no sqrt per iteration
+        float norm = dot(z_value_iterated, z_value_iterated);
+        if (norm > threshold2) {
+            escape_norm = norm;
+            break;
+        }
+        if (periodicity_tolerance > 0.0) {
+            vec2 diff = abs(z_value_iterated - z_saved);
+            if (diff.x < periodicity_tolerance && diff.y < periodicity_tolerance) {
+                return n_iterations;
+            }
+            if (iter + 1 == checkpoint) {
+                z_saved = z_value_iterated;
+                checkpoint *= 2;
+            }
+        }
+    }
+    return iter;
+}
+
+// Same count in float-float for the pixel at offset from the view center.
+// Real and imaginary part are carried as separate (hi, lo) pairs.
+int iterateFloatFloat(vec2 offset, out float escape_norm) {
+    escape_norm = 0.0;
+    vec2 c_real = ffAdd(vec2(view_center.x, view_center_lo.x), vec2(offset.x, 0.0));
+    vec2 c_imag = ffAdd(vec2(view_center.y, view_center_lo.y), vec2(offset.y, 0.0));
+    if (POWER == 2 && interior_check && inCardioidOrBulb(vec2(c_real.x, c_imag.x))) {
+        return n_iterations;
+    }
+
+    vec2 z_real = vec2(0.0);
+    vec2 z_imag = vec2(0.0);
+    vec2 saved_real = z_real;
+    vec2 saved_imag = z_imag;
+    int checkpoint = 1;
+    float threshold2 = threshold * threshold;
+
+    int iter = 0;
+    for (iter; iter < n_iterations; iter++) {
+#if POWER == 2
+        vec2 z_real2 = ffMul(z_real, z_real);
+        vec2 z_imag2 = ffMul(z_imag, z_imag);
+        z_imag = ffAdd(ffMul(2.0 * z_real, z_imag), c_imag);
+        z_real = ffAdd(ffAdd(z_real2, -z_imag2), c_real);
+#else
+        vec2 p_real = z_real;
+        vec2 p_imag = z_imag;
+        for (int i = 1; i < POWER; i++) {
+            vec2 next_real = ffAdd(ffMul(p_real, z_real), -ffMul(p_imag, z_imag));
+            p_imag = ffAdd(ffMul(p_real, z_imag), ffMul(p_imag, z_real));
+            p_real = next_real;
+        }
+        z_real = ffAdd(p_real, c_real);
+        z_imag = ffAdd(p_imag, c_imag);
+#endif
+
+        float norm = z_real.x * z_real.x + z_imag.x * z_imag.x;
+        if (norm > threshold2) {
+            escape_norm = norm;
             break;
         }
+        if (periodicity_tolerance > 0.0) {
+            if (abs(ffAdd(z_real, -saved_real).x) < periodicity_tolerance && abs(ffAdd(z_imag, -saved_imag).x) < periodicity_tolerance) {
+                return n_iterations;
+            }
+            if (iter + 1 == checkpoint) {
+                saved_real = z_real;
+                saved_imag = z_imag;
+                checkpoint *= 2;
+            }
+        }
+    }
+    return iter;
+}
+
+void main()
+{
+    int iter;
+    float escape_norm;
+    if (float_float) {
+        iter = iterateFloatFloat(pixelOffset(gl_FragCoord.xy), escape_norm);
+    } else {
+        // complex_val.x - real, complex_val.y - imag
+        iter = iterateFloat(pixelToComplex(gl_FragCoord.xy), escape_norm);
     }
-    vec3 color = computeColorIteration(iter);
+    vec3 color = computeColorIteration(smoothIteration(iter, escape_norm));
 
     FragColor = vec4(color.r, color.g, color.b, 1.0);
 }
\ No newline at end of file
@@ -1,12 +1,28 @@
 #version 400 core
+// Exponent d of z -> z^d + c (2 for the Mandelbrot set), fixed when the shader
+// is compiled so the power loop unrolls and the z^2 case keeps its short form
+#define POWER 2
 out dvec4 FragColor; // Use vec4 here
 in dvec2 TexCoord;
 
 uniform sampler1D colormap;
-uniform sampler2D complexSet;
+// View transform: center, real/imaginary extent and (cos, sin) of the
+// rotation. Pixel coordinates are derived from gl_FragCoord, so no per-pixel
+// coordinate data is uploaded.
+uniform dvec2 view_center;
+uniform dvec2 view_extent;
+uniform dvec2 view_rotation;
+uniform vec2 resolution;
 
 uniform int n_iterations;
 uniform double threshold;
+// Continuous count constants, as in the float shader
+uniform float norm_scale;
+uniform float power_scale;
+// Skip the main cardioid and period-2 bulb (known interior) when set
+uniform bool interior_check;
+// Orbits closing within this distance are declared interior, 0 disables
+uniform double periodicity_tolerance;
 
 dvec2 complexMul(dvec2 a, dvec2 b) {
     double real = a.x * b.x - a.y * b.y;
@@ -15,39 +31,99 @@ dvec2 complexMul(dvec2 a, dvec2 b) {
 }
 
 dvec2 mandelbrotFunc(dvec2 z_val, dvec2 complex_val) {
+#if POWER == 2
     return complexMul(z_val, z_val) + complex_val;
+#else
+    dvec2 z_power = z_val;
+    for (int i = 1; i < POWER; i++) {
+        z_power = complexMul(z_power, z_val);
+    }
+    return z_power + complex_val;
+#endif
 }
 
-dvec3 computeColorIteration(int iter) {
-    dvec3 color;
-    if (iter == n_iterations) {
-        color = dvec3(0.0, 0.0, 0.0);
-    } else {
-        if (iter == n_iterations) {
-            color = dvec3(0.5, 0.5, 0.0); // Example: Change to a distinct color, e.g., orange
-        } else {
-            // Color for points outside the Mandelbrot set, based on escape time
-            double colorIndex = log(double(iter)) / log(double(n_iterations));
-            color = texture(colormap, colorIndex).rgb;
-        }
+// Complex coordinate of the pixel center at fragCoord
+dvec2 pixelToComplex(vec2 fragCoord) {
+    dvec2 offset = (dvec2(fragCoord) / dvec2(resolution) - 0.5) * view_extent;
+    return view_center + dvec2(offset.x * view_rotation.x - offset.y * view_rotation.y,
+        offset.x * view_rotation.y + offset.y * view_rotation.x);
+}
+
+// Closed-form membership test for the main cardioid and the period-2 bulb
+bool inCardioidOrBulb(dvec2 c) {
+    double y2 = c.y * c.y;
+    double xq = c.x - 0.25;
+    double q = xq * xq + y2;
+    if (q * (q + xq) <= 0.25 * y2) {
+        return true;
     }
-    return color;
+    double xb = c.x + 1.0;
+    return xb * xb + y2 <= 0.0625;
+}
+
+// fastLog2, continuous count and its color, as in the float shader. |z|^2 at
+// escape is far inside the range of float.
+float fastLog2(float x) {
+    int bits = floatBitsToInt(x);
+    float exponent = float(((bits >> 23) & 0xFF) - 127);
+    float t = intBitsToFloat((bits & 0x007FFFFF) | 0x3F800000) - 1.0;
+    return exponent + t * (1.4380732 + t * (-0.67476666 + t * (0.31700072 + t * -0.080307304)));
+}
+
+float smoothIteration(int iter, double escape_norm) {
+    if (iter >= n_iterations || !(escape_norm > 1.0)) {
+        return float(min(iter, n_iterations));
+    }
+    float fraction = 1.0 - fastLog2(fastLog2(float(escape_norm)) * norm_scale) * power_scale;
+    return float(iter) + clamp(fraction, 0.0, 255.0 / 256.0);
+}
+
+dvec3 computeColorIteration(float iteration) {
+    int iter = clamp(int(iteration), 0, n_iterations);
+    int next = iter + 1 < n_iterations ? iter + 1 : iter;
+    vec3 low = texelFetch(colormap, iter, 0).rgb;
+    vec3 high = texelFetch(colormap, next, 0).rgb;
+    return dvec3(mix(low, high, iteration - float(iter)));
 }
 
 void main() {
-    dvec2 complex_val = texture(complexSet, TexCoord).rg;
+    dvec2 complex_val = pixelToComplex(gl_FragCoord.xy);
 
     dvec2 z_value_iterated = dvec2(0.0, 0.0);
     int iter = 0;
+    double escape_norm = 0.0;
+
+    if (POWER == 2 && interior_check && inCardioidOrBulb(complex_val)) {
+        iter = n_iterations;
+    }
+
+    // Brent-style cycle detection against an orbit point saved at powers of two
+    dvec2 z_saved = z_value_iterated;
+    int checkpoint = 1;
+    double threshold2 = threshold * threshold;
 
     for (iter; iter < n_iterations; iter++) {
         z_value_iterated = mandelbrotFunc(z_value_iterated, complex_val);
 
-        if (length(z_value_iterated) > threshold) {
+        // |z|^2 against the squared radius, no sqrt per iteration
+        double norm = dot(z_value_iterated, z_value_iterated);
+        if (norm > threshold2) {
+            escape_norm = norm;
             break;
         }
+        if (periodicity_tolerance > 0.0) {
+            dvec2 diff = abs(z_value_iterated - z_saved);
+            if (diff.x < periodicity_tolerance && diff.y < periodicity_tolerance) {
+                iter = n_iterations;
+                break;
+            }
+            if (iter + 1 == checkpoint) {
+                z_saved = z_value_iterated;
+                checkpoint *= 2;
+            }
+        }
     }
-    dvec3 color = computeColorIteration(iter);
+    dvec3 color = computeColorIteration(smoothIteration(iter, escape_norm));
 
     FragColor = dvec4(color, 1.0); // Convert dvec3 color to vec4
 }
\ No newline at end of file
@@ -0,0 +1,299 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifndef BIG_FIXED_HPP
+#define BIG_FIXED_HPP
+
+// Signed fixed-point number with one 32-bit integer limb and a runtime number
+// of 32-bit fraction limbs, used where double runs out of precision (e.g. the
+// perturbation reference orbit and the exact view center). Limbs are little
+// endian: limbs[0] is the least significant fraction limb, limbs.back() the
+// integer part. All operands of an operation must have the same number of
+// fraction limbs, withFractionLimbs converts between precisions.
+class BigFixed {
+public:
+    BigFixed() : limbs(1, 0) {}
+
+    explicit BigFixed(int fractionLimbs) : limbs(static_cast<size_t>(fractionLimbs) + 1, 0) {}
+
+    // Exact conversion as long as |value| < 2^32 and the fraction limbs hold
+    // all of its mantissa bits, truncated otherwise. Larger magnitudes (and
+    // infinities) saturate to the largest one representable, NaN gives 0.
+    static BigFixed fromDouble(double value, int fractionLimbs) {
+        BigFixed result(fractionLimbs);
+        if (std::isnan(value)) return result;
+        result.negative = value < 0.0;
+        double magnitude = std::fabs(value);
+        if (magnitude >= 0x1p32) {
+            std::fill(result.limbs.begin(), result.limbs.end(), 0xffffffffu);
+            return result;
+        }
+        const double integerPart = std::floor(magnitude);
+        result.limbs.back() = static_cast<std::uint32_t>(integerPart);
+        magnitude -= integerPart;
+        for (int i = fractionLimbs - 1; i >= 0 && magnitude > 0.0; --i) {
+            magnitude = std::ldexp(magnitude, 32);
+            const double limb = std::floor(magnitude);
+            result.limbs[i] = static_cast<std::uint32_t>(limb);
+            magnitude -= limb;
+        }
+        return result;
+    }
+
+    // Parse a decimal number such as "-0.7436438870371587047", exact up to
+    // the truncation to fractionLimbs. Returns false for malformed text or
+    // an integer part that does not fit one limb.
+    static bool fromDecimal(const std::string& text, int fractionLimbs, BigFixed& result) {
+        size_t pos = 0;
+        const bool negative = !text.empty() && (text[0] == '-' || text[0] == '+') ? text[pos++] == '-' : false;
+        const size_t point = text.find('.', pos);
+        const std::string integerDigits = text.substr(pos, point == std::string::npos ? std::string::npos : point - pos);
+        const std::string fractionDigits = point == std::string::npos ? std::string() : text.substr(point + 1);
+        if (integerDigits.empty() && fractionDigits.empty()) return false;
+        const auto isDigit = [](char c) { return c >= '0' && c <= '9'; };
+        if (!std::all_of(integerDigits.begin(), integerDigits.end(), isDigit) || !std::all_of(fractionDigits.begin(), fractionDigits.end(), isDigit)) return false;
+
+        BigFixed value(fractionLimbs);
+        // Fraction from the last digit up: f = (digit + f) / 10
+        for (size_t i = fractionDigits.size(); i-- > 0;) {
+            value.limbs.back() += static_cast<std::uint32_t>(fractionDigits[i] - '0');
+            value.divideInPlace(10);
+        }
+        std::uint64_t integerPart = 0;
+        for (char digit : integerDigits) {
+            integerPart = integerPart * 10 + static_cast<std::uint64_t>(digit - '0');
+            if (integerPart > 0xffffffffu) return false;
+        }
+        value.limbs.back() = static_cast<std::uint32_t>(integerPart);
+        value.negative = negative && !value.isZero();
+        result = std::move(value);
+        return true;
+    }
+
+    double toDouble() const {
+        double result = 0.0;
+        const int fraction = fractionLimbs();
+        for (int i = 0; i <= fraction; ++i) {
+            result += std::ldexp(static_cast<double>(limbs[i]), 32 * (i - fraction));
+        }
+        return negative ? -result : result;
+    }
+
+    int fractionLimbs() const { return static_cast<int>(limbs.size()) - 1; }
+
+    // Same value with more (exact) or fewer (truncated) fraction limbs
+    BigFixed withFractionLimbs(int fractionLimbs) const {
+        BigFixed result(fractionLimbs);
+        const int shared = std::min(fractionLimbs, this->fractionLimbs()) + 1;
+        std::copy(limbs.end() - shared, limbs.end(), result.limbs.end() - shared);
+        result.negative = negative && !result.isZero();
+        return result;
+    }
+
+    BigFixed operator-() const {
+        BigFixed result = *this;
+        result.negative = !negative && !result.isZero();
+        return result;
+    }
+
+    friend BigFixed operator+(const BigFixed& a, const BigFixed& b) {
+        return addSigned(a, b, b.negative);
+    }
+
+    friend BigFixed operator-(const BigFixed& a, const BigFixed& b) {
+        return addSigned(a, b, !b.negative);
+    }
+
+    // Product truncated to the operands' precision. Partial products that
+    // only reach the discarded half are skipped, apart from one guard limb,
+    // so the result is within a few units of the last limb. Like every
+    // value, the product has to stay below 2^32 in magnitude; the carry out
+    // of the integer limb is dropped, so callers bound their operands.
+    friend BigFixed operator*(const BigFixed& a, const BigFixed& b) {
+        return fromProduct(productLimbs(a, b), a.limbs.size() - 1, a.negative != b.negative);
+    }
+
+    // this * this, computing each cross product a_i a_j only once
+    BigFixed square() const {
+        const size_t n = limbs.size();
+        const size_t fraction = n - 1;
+        const size_t guard = fraction > 0 ? fraction - 1 : 0;
+        std::vector<std::uint32_t> product(2 * n, 0);
+        // Cross products a_i a_j with i < j
+        for (size_t i = 0; i < n; ++i) {
+            std::uint64_t carry = 0;
+            const std::uint64_t ai = limbs[i];
+            if (ai == 0) continue;
+            for (size_t j = std::max(i + 1, guard > i ? guard - i : 0); j < n; ++j) {
+                const std::uint64_t t = ai * limbs[j] + product[i + j] + carry;
+                product[i + j] = static_cast<std::uint32_t>(t);
+                carry = t >> 32;
+            }
+            product[i + n] = static_cast<std::uint32_t>(carry);
+        }
+        // Double them, then add the squares a_i^2
+        std::uint32_t shifted = 0;
+        for (auto& limb : product) {
+            const std::uint32_t next = limb >> 31;
+            limb = (limb << 1) | shifted;
+            shifted = next;
+        }
+        std::uint64_t carry = 0;
+        for (size_t i = 0; i < n; ++i) {
+            const std::uint64_t square = static_cast<std::uint64_t>(limbs[i]) * limbs[i];
+            std::uint64_t t = static_cast<std::uint64_t>(product[2 * i]) + static_cast<std::uint32_t>(square) + carry;
+            product[2 * i] = static_cast<std::uint32_t>(t);
+            t = static_cast<std::uint64_t>(product[2 * i + 1]) + (square >> 32) + (t >> 32);
+            product[2 * i + 1] = static_cast<std::uint32_t>(t);
+            carry = t >> 32;
+        }
+        return fromProduct(product, fraction, false);
+    }
+
+    // a * b + c, rounded like a * b followed by += c. c is added into the
+    // kept limbs of the product before they are copied out, so no separate
+    // product value is made.
+    static BigFixed mulAdd(const BigFixed& a, const BigFixed& b, const BigFixed& c) {
+        const size_t fraction = a.limbs.size() - 1;
+        std::vector<std::uint32_t> product = productLimbs(a, b);
+        const bool negative = addLimbs(product.data() + fraction, a.negative != b.negative, c.limbs.data(), c.negative, c.limbs.size());
+        return fromProduct(product, fraction, negative);
+    }
+
+    BigFixed& operator+=(const BigFixed& other) {
+        addInPlace(other, other.negative);
+        return *this;
+    }
+
+    BigFixed& operator-=(const BigFixed& other) {
+        addInPlace(other, !other.negative);
+        return *this;
+    }
+
+    // 2 * this, exact
+    BigFixed doubled() const {
+        BigFixed result = *this;
+        std::uint32_t carry = 0;
+        for (auto& limb : result.limbs) {
+            const std::uint32_t next = limb >> 31;
+            limb = (limb << 1) | carry;
+            carry = next;
+        }
+        return result;
+    }
+
+    bool isZero() const {
+        for (std::uint32_t limb : limbs) {
+            if (limb != 0) return false;
+        }
+        return true;
+    }
+
+private:
+    std::vector<std::uint32_t> limbs;
+    bool negative = false;
+
+    // |this| /= divisor, truncated
+    void divideInPlace(std::uint32_t divisor) {
+        std::uint64_t remainder = 0;
+        for (size_t i = limbs.size(); i-- > 0;) {
+            const std::uint64_t t = (remainder << 32) | limbs[i];
+            limbs[i] = static_cast<std::uint32_t>(t / divisor);
+            remainder = t % divisor;
+        }
+    }
+
+    // Full product of the magnitudes, 2 * fraction fraction limbs of which
+    // only the top ones are kept (see operator*)
+    static std::vector<std::uint32_t> productLimbs(const BigFixed& a, const BigFixed& b) {
+        const size_t n = a.limbs.size();
+        const size_t fraction = n - 1;
+        const size_t guard = fraction > 0 ? fraction - 1 : 0;
+        std::vector<std::uint32_t> product(2 * n, 0);
+        for (size_t i = 0; i < n; ++i) {
+            std::uint64_t carry = 0;
+            const std::uint64_t ai = a.limbs[i];
+            if (ai == 0) continue;
+            for (size_t j = guard > i ? guard - i : 0; j < n; ++j) {
+                // (2^32 - 1)^2 + 2 * (2^32 - 1) fits in 64 bits
+                const std::uint64_t t = ai * b.limbs[j] + product[i + j] + carry;
+                product[i + j] = static_cast<std::uint32_t>(t);
+                carry = t >> 32;
+            }
+            product[i + n] = static_cast<std::uint32_t>(carry);
+        }
+        return product;
+    }
+
+    // Top half of a product, limbs [fraction, fraction + n) of the full result
+    static BigFixed fromProduct(const std::vector<std::uint32_t>& product, size_t fraction, bool negative) {
+        BigFixed result(static_cast<int>(fraction));
+        std::copy(product.begin() + fraction, product.begin() + 2 * fraction + 1, result.limbs.begin());
+        result.negative = negative && !result.isZero();
+        return result;
+    }
+
+    // a + b, with b's sign replaced by bNegative
+    static BigFixed addSigned(const BigFixed& a, const BigFixed& b, bool bNegative) {
+        BigFixed result = a;
+        result.addInPlace(b, bNegative);
+        return result;
+    }
+
+    // this += other, with other's sign replaced by otherNegative
+    void addInPlace(const BigFixed& other, bool otherNegative) {
+        negative = addLimbs(limbs.data(), negative, other.limbs.data(), otherNegative, limbs.size());
+        if (isZero()) negative = false;
+    }
+
+    // Signed magnitudes: limbs[0, count) += other[0, count), returns the sign
+    // of the sum
+    static bool addLimbs(std::uint32_t* limbs, bool negative, const std::uint32_t* other, bool otherNegative, size_t count) {
+        if (negative == otherNegative) {
+            std::uint64_t carry = 0;
+            for (size_t i = 0; i < count; ++i) {
+                const std::uint64_t t = static_cast<std::uint64_t>(limbs[i]) + other[i] + carry;
+                limbs[i] = static_cast<std::uint32_t>(t);
+                carry = t >> 32;
+            }
+            return negative;
+        }
+        // Subtract the smaller magnitude from the larger one
+        bool thisLarger = true;
+        for (size_t i = count; i-- > 0;) {
+            if (limbs[i] != other[i]) {
+                thisLarger = limbs[i] > other[i];
+                break;
+            }
+        }
+        std::int64_t borrow = 0;
+        for (size_t i = 0; i < count; ++i) {
+            const std::int64_t larger = thisLarger ? limbs[i] : other[i];
+            const std::int64_t smaller = thisLarger ? other[i] : limbs[i];
+            const std::int64_t t = larger - smaller - borrow;
+            borrow = t < 0 ? 1 : 0;
+            limbs[i] = static_cast<std::uint32_t>(t + (borrow << 32));
+        }
+        return thisLarger ? negative : otherNegative;
+    }
+};
+
+// Point of the complex plane in BigFixed precision
+struct BigComplex {
+    BigFixed real;
+    BigFixed imag;
+};
+
+// Fraction limbs needed to resolve features of the given size, with enough
+// guard bits that rounding in long orbits stays far below it
+inline int fractionLimbsForSpacing(double pixelSpacing) {
+    const int guardBits = 64;
+    const int bits = static_cast<int>(std::ceil(-std::log2(pixelSpacing))) + guardBits;
+    return std::max(2, (bits + 31) / 32);
+}
+
+#endif
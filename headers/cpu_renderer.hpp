@@ -0,0 +1,613 @@
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifndef CPU_RENDERER_HPP
+#define CPU_RENDERER_HPP
+
+// Local
+#include "mandelbrot_core.hpp"
+#include "mandelbrot_kernel.hpp"
+#include "perturbation.hpp"
+#include "thread_pool.hpp"
+#include "viewport.hpp"
+
+// Internals of the mandelbrot_core library: tiles a frame over a
+// TileThreadPool, picks the precision tier for the zoom and fills the
+// iteration and / or RGBA buffers. Frontends use MandelbrotRenderer instead.
+
+// Function to map a value from one range to another
+inline double map(double value, double inMin, double inMax, double outMin, double outMax) {
+    return (value - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
+}
+
+// Pixel positions (x, y)
+using PixelList = std::vector<std::pair<int, int>>;
+
+// Everything a render thread needs to know about the frame. Rows and columns
+// map to the view axes, the CPU renderer does not rotate the view.
+struct FrameParams {
+    Viewport view;
+    int maxIterations = 0;
+    KernelOptions options;
+    int width = 0;
+    int height = 0;
+    Palette palette = Palette::Gradient;
+    Coloring coloring = Coloring::Banded;
+    bool perturbation = true;
+    // Colors of palette, set by renderFrame when there is an RGBA target
+    const PaletteTable* paletteTable = nullptr;
+    // Set by renderFrame when a target needs continuous counts: the kernels
+    // then also report |z|^2 at escape
+    bool continuous = false;
+    SmoothCountScale smoothScale{};
+    // Set for deep zooms: pixels are then iterated by perturbation against
+    // this orbit, and their coordinates are deltas from its position
+    const ReferenceOrbit* reference = nullptr;
+    // Set for double-double frames: pixel coordinates are then deltas from
+    // the view center, which is carried in double-double
+    bool doubleDouble = false;
+    DoubleDouble centerReal{};
+    DoubleDouble centerImag{};
+    // Progressive passes compute only every sampleStep-th pixel of each row
+    // and column and fill the sampleStep x sampleStep block right of and
+    // below it. Samples of an earlier pass with previousStep (a multiple of
+    // sampleStep, 0 for none) are already in the buffers and skipped.
+    int sampleStep = 1;
+    int previousStep = 0;
+    // Hooks of RenderRequest, may be empty
+    std::function<bool()> cancelled{};
+    std::function<void(int x0, int y0, int x1, int y1)> tileDone{};
+
+    bool isCancelled() const { return cancelled && cancelled(); }
+
+    double stepReal() const { return view.realSpan() / width; }
+    double stepImag() const { return view.imagSpan() / height; }
+
+    // Pixel coordinates as the kernel expects them
+    double pixelReal(int x) const {
+        if (reference) return (x - reference->pixelX) * stepReal();
+        if (doubleDouble) return (x - 0.5 * width) * stepReal();
+        return map(x, 0, width, view.center.real() - 0.5 * view.realSpan(), view.center.real() + 0.5 * view.realSpan());
+    }
+    double pixelImag(int y) const {
+        if (reference) return (y - reference->pixelY) * stepImag();
+        if (doubleDouble) return (y - 0.5 * height) * stepImag();
+        return map(y, 0, height, view.center.imag() - 0.5 * view.imagSpan(), view.center.imag() + 0.5 * view.imagSpan());
+    }
+    // Spacing of neighbouring pixels, the finer of both axes
+    double pixelSpacing() const { return std::min(stepReal(), stepImag()); }
+
+    // Exact coordinate of a pixel, e.g. for a reference orbit
+    BigComplex exactPixel(double x, double y, int fractionLimbs) const {
+        BigComplex c = view.exactCenter(fractionLimbs);
+        c.real += BigFixed::fromDouble((x - 0.5 * width) * stepReal(), fractionLimbs);
+        c.imag += BigFixed::fromDouble((y - 0.5 * height) * stepImag(), fractionLimbs);
+        return c;
+    }
+
+    // Iteration counts for points given by pixelReal / pixelImag, and |z|^2
+    // at escape when norms is not null
+    void iterationCounts(const double* real, const double* imag, int count, int* iterations, double* norms, KernelStats& stats) const {
+        if (reference) {
+            perturbedIterationCounts(*reference, real, imag, count, maxIterations, options, iterations, &stats, norms);
+        } else if (doubleDouble) {
+            mandelbrotIterationCounts(centerReal, centerImag, real, imag, count, maxIterations, options, iterations, &stats, norms);
+        } else {
+            mandelbrotIterationCounts(real, imag, count, maxIterations, options, iterations, &stats, norms);
+        }
+    }
+};
+
+// Output buffers of a frame, any may be null. All are indexed by
+// y * width + x (4 bytes per pixel for RGBA).
+struct FrameTarget {
+    std::uint8_t* rgba = nullptr;
+    int* iterations = nullptr;
+    // Continuous counts, see smoothIterationCount
+    int* smoothIterations = nullptr;
+};
+
+// Everything stored for one computed pixel
+struct PixelValue {
+    int iteration;
+    int smoothIteration;
+    std::uint32_t color;
+};
+
+// norm is |z|^2 at escape, only read for continuous frames
+inline PixelValue pixelValue(int iteration, double norm, const FrameParams& frame) {
+    PixelValue value{iteration, 0, 0};
+    if (frame.continuous) value.smoothIteration = smoothIterationCount(iteration, norm, frame.maxIterations, frame.smoothScale);
+    if (frame.paletteTable) {
+        value.color = frame.coloring == Coloring::Smooth ? smoothColor(*frame.paletteTable, value.smoothIteration)
+                                                         : frame.paletteTable->colors[std::clamp(iteration, 0, frame.maxIterations)];
+    }
+    return value;
+}
+
+inline void storePixel(const FrameTarget& target, int x, int y, const PixelValue& value, const FrameParams& frame) {
+    const size_t index = static_cast<size_t>(y) * frame.width + x;
+    if (target.iterations) target.iterations[index] = value.iteration;
+    if (target.smoothIterations) target.smoothIterations[index] = value.smoothIteration;
+    if (target.rgba) std::memcpy(target.rgba + 4 * index, &value.color, 4);
+}
+
+// Store a computed sample, which covers its whole block in progressive passes
+inline void storeSample(const FrameTarget& target, int x, int y, const PixelValue& value, const FrameParams& frame) {
+    if (frame.sampleStep == 1) {
+        storePixel(target, x, y, value, frame);
+        return;
+    }
+    const int endX = std::min(x + frame.sampleStep, frame.width);
+    const int endY = std::min(y + frame.sampleStep, frame.height);
+    const std::uint32_t color = value.color;
+    for (int blockY = y; blockY < endY; ++blockY) {
+        const size_t row = static_cast<size_t>(blockY) * frame.width;
+        if (target.iterations) std::fill(target.iterations + row + x, target.iterations + row + endX, value.iteration);
+        if (target.smoothIterations) std::fill(target.smoothIterations + row + x, target.smoothIterations + row + endX, value.smoothIteration);
+        if (target.rgba) {
+            for (int blockX = x; blockX < endX; ++blockX) {
+                std::memcpy(target.rgba + 4 * (row + blockX), &color, 4);
+            }
+        }
+    }
+}
+
+// Render one section (tile) of the image. Each row of the section goes through
+// the batched (SIMD) kernel in one call. Sections never overlap, so every
+// thread writes its own pixels of the buffers without any locking.
+// Glitched pixels of a perturbed frame are left uncolored and listed.
+// Sections start at multiples of frame.sampleStep.
+inline void renderSection(const FrameTarget& target, int startX, int endX, int startY, int endY, const FrameParams& frame, KernelStats& stats, PixelList& glitches) {
+    const int step = frame.sampleStep;
+    // Sampled columns, and those of rows the previous pass already sampled
+    std::vector<int> columns;
+    std::vector<int> newColumns;
+    for (int x = startX; x < endX; x += step) {
+        columns.push_back(x);
+        if (frame.previousStep == 0 || x % frame.previousStep != 0) newColumns.push_back(x);
+    }
+    std::vector<double> real(columns.size());
+    std::vector<double> newReal(newColumns.size());
+    std::vector<double> imag(columns.size());
+    std::vector<int> iterations(columns.size());
+    std::vector<double> norms(frame.continuous ? columns.size() : 0);
+    std::transform(columns.begin(), columns.end(), real.begin(), [&](int x) { return frame.pixelReal(x); });
+    std::transform(newColumns.begin(), newColumns.end(), newReal.begin(), [&](int x) { return frame.pixelReal(x); });
+
+    for (int y = startY; y < endY; y += step) {
+        const bool sampledRow = frame.previousStep > 0 && y % frame.previousStep == 0;
+        const std::vector<int>& rowColumns = sampledRow ? newColumns : columns;
+        const int count = static_cast<int>(rowColumns.size());
+        std::fill(imag.begin(), imag.begin() + count, frame.pixelImag(y));
+        frame.iterationCounts(sampledRow ? newReal.data() : real.data(), imag.data(), count, iterations.data(), frame.continuous ? norms.data() : nullptr, stats);
+        for (int i = 0; i < count; ++i) {
+            if (iterations[i] == glitchedIteration) {
+                glitches.emplace_back(rowColumns[i], y);
+            } else {
+                storeSample(target, rowColumns[i], y, pixelValue(iterations[i], frame.continuous ? norms[i] : 0.0, frame), frame);
+            }
+        }
+    }
+}
+
+// Iteration counts of one section for the subdivision renderer, -1 marks
+// pixels that are neither computed nor filled yet, glitchedIteration pixels
+// that need another perturbation reference. norms holds |z|^2 at escape of
+// computed pixels in continuous frames. The point buffers are scratch space
+// reused by every rectangle of the section.
+struct SectionCounts {
+    int startX;
+    int startY;
+    int width;
+    std::vector<int> counts;
+    std::vector<double> norms;
+    PixelList points;
+    PixelList pending;
+    std::vector<double> real;
+    std::vector<double> imag;
+    std::vector<int> iterations;
+    std::vector<double> escapeNorms;
+
+    int& at(int x, int y) { return counts[(y - startY) * width + (x - startX)]; }
+    double& normAt(int x, int y) { return norms[(y - startY) * width + (x - startX)]; }
+};
+
+// Compute the still unknown pixels among section.points in a single kernel
+// call. The coordinates are the same as in renderSection, so computed pixels
+// match the brute force output exactly.
+inline void computePixels(SectionCounts& section, const FrameParams& frame, KernelStats& stats) {
+    section.pending.clear();
+    section.real.clear();
+    section.imag.clear();
+    for (const auto& [x, y] : section.points) {
+        if (section.at(x, y) == -1) {
+            section.at(x, y) = 0; // Points can be listed twice on thin rectangles
+            section.pending.emplace_back(x, y);
+            section.real.push_back(frame.pixelReal(x));
+            section.imag.push_back(frame.pixelImag(y));
+        }
+    }
+    section.iterations.resize(section.pending.size());
+    section.escapeNorms.resize(frame.continuous ? section.pending.size() : 0);
+    frame.iterationCounts(section.real.data(), section.imag.data(), static_cast<int>(section.pending.size()), section.iterations.data(),
+                          frame.continuous ? section.escapeNorms.data() : nullptr, stats);
+    for (size_t i = 0; i < section.pending.size(); ++i) {
+        const auto [x, y] = section.pending[i];
+        section.at(x, y) = section.iterations[i];
+        if (frame.continuous) section.normAt(x, y) = section.escapeNorms[i];
+    }
+}
+
+// Compute the still unknown pixels on the one pixel wide ring around the
+// rectangle [x0, x1] x [y0, y1] (inclusive) and return whether all of them
+// have the count of its corner (x0, y0). The ring is left in section.points.
+inline bool computeRing(SectionCounts& section, int x0, int y0, int x1, int y1, const FrameParams& frame, KernelStats& stats) {
+    PixelList& ring = section.points;
+    ring.clear();
+    for (int x = x0; x <= x1; ++x) {
+        ring.emplace_back(x, y0);
+        ring.emplace_back(x, y1);
+    }
+    for (int y = y0 + 1; y < y1; ++y) {
+        ring.emplace_back(x0, y);
+        ring.emplace_back(x1, y);
+    }
+    computePixels(section, frame, stats);
+    const int count = section.at(x0, y0);
+    bool uniform = true;
+    for (const auto& [x, y] : ring) {
+        uniform = uniform && section.at(x, y) == count;
+    }
+    return uniform;
+}
+
+// Mariani-Silver subdivision of the rectangle [x0, x1] x [y0, y1] (inclusive):
+// only the border is computed, a border with a single iteration count gets
+// its inside filled with that count, any other rectangle is split in four.
+// The border is two pixels thick: a filament can escape between two samples
+// of a one pixel border and leave a single escaped pixel just inside it,
+// which brute force shows in the default view. Continuous counts differ
+// inside escaped rectangles, so continuous frames only fill rectangles
+// inside the set.
+inline void subdivideRect(SectionCounts& section, int x0, int y0, int x1, int y1, const FrameParams& frame, KernelStats& stats) {
+    // Below this size splitting again costs more than computing the inside
+    const int minRectSize = 4;
+
+    bool uniform = computeRing(section, x0, y0, x1, y1, frame, stats);
+    if (x1 - x0 < 2 || y1 - y0 < 2) return; // Nothing inside the border
+
+    const int first = section.at(x0, y0);
+    if (frame.continuous && first != frame.maxIterations) uniform = false;
+    if (uniform && x1 - x0 > 2 && y1 - y0 > 2) {
+        uniform = computeRing(section, x0 + 1, y0 + 1, x1 - 1, y1 - 1, frame, stats) && section.at(x0 + 1, y0 + 1) == first;
+    }
+
+    if (uniform) {
+        for (int y = y0 + 1; y < y1; ++y) {
+            for (int x = x0 + 1; x < x1; ++x) {
+                section.at(x, y) = first;
+            }
+        }
+    } else if (x1 - x0 <= minRectSize || y1 - y0 <= minRectSize) {
+        section.points.clear();
+        for (int y = y0 + 1; y < y1; ++y) {
+            for (int x = x0 + 1; x < x1; ++x) {
+                section.points.emplace_back(x, y);
+            }
+        }
+        computePixels(section, frame, stats);
+    } else {
+        // Children share their edges, which are computed only once
+        const int midX = (x0 + x1) / 2;
+        const int midY = (y0 + y1) / 2;
+        subdivideRect(section, x0, y0, midX, midY, frame, stats);
+        subdivideRect(section, midX, y0, x1, midY, frame, stats);
+        subdivideRect(section, x0, midY, midX, y1, frame, stats);
+        subdivideRect(section, midX, midY, x1, y1, frame, stats);
+    }
+}
+
+// Same contract as renderSection, rendered by rectangle subdivision
+inline void renderSectionSubdivided(const FrameTarget& target, int startX, int endX, int startY, int endY, const FrameParams& frame, KernelStats& stats, PixelList& glitches) {
+    const size_t pixels = static_cast<size_t>(endX - startX) * (endY - startY);
+    SectionCounts section{startX, startY, endX - startX, std::vector<int>(pixels, -1), std::vector<double>(frame.continuous ? pixels : 0), {}, {}, {}, {}, {}, {}};
+    subdivideRect(section, startX, startY, endX - 1, endY - 1, frame, stats);
+    for (int y = startY; y < endY; ++y) {
+        for (int x = startX; x < endX; ++x) {
+            if (section.at(x, y) == glitchedIteration) {
+                glitches.emplace_back(x, y);
+            } else {
+                storePixel(target, x, y, pixelValue(section.at(x, y), frame.continuous ? section.normAt(x, y) : 0.0, frame), frame);
+            }
+        }
+    }
+}
+
+// Render the pixels glitches[first, last) of a perturbed frame again against
+// frame.reference. Pixels that still glitch are added to stillGlitched.
+inline void renderPixels(const FrameTarget& target, const PixelList& glitches, int first, int last, const FrameParams& frame, KernelStats& stats, PixelList& stillGlitched) {
+    const int count = last - first;
+    std::vector<double> real(count);
+    std::vector<double> imag(count);
+    std::vector<int> iterations(count);
+    std::vector<double> norms(frame.continuous ? count : 0);
+    for (int i = 0; i < count; ++i) {
+        real[i] = frame.pixelReal(glitches[first + i].first);
+        imag[i] = frame.pixelImag(glitches[first + i].second);
+    }
+    frame.iterationCounts(real.data(), imag.data(), count, iterations.data(), frame.continuous ? norms.data() : nullptr, stats);
+    for (int i = 0; i < count; ++i) {
+        const auto [x, y] = glitches[first + i];
+        if (iterations[i] == glitchedIteration) {
+            stillGlitched.emplace_back(x, y);
+        } else {
+            storeSample(target, x, y, pixelValue(iterations[i], frame.continuous ? norms[i] : 0.0, frame), frame);
+        }
+    }
+}
+
+// Series approximation for a reference orbit of the frame. The probes are
+// the frame corners and edge midpoints, where the series is least accurate.
+inline void prepareSeries(ReferenceOrbit& orbit, const FrameParams& frame) {
+    std::vector<std::complex<double>> probes;
+    for (int x : {0, frame.width / 2, frame.width - 1}) {
+        for (int y : {0, frame.height / 2, frame.height - 1}) {
+            probes.emplace_back((x - orbit.pixelX) * frame.stepReal(), (y - orbit.pixelY) * frame.stepImag());
+        }
+    }
+    computeSeriesApproximation(orbit, probes, frame.maxIterations, frame.options.bailoutNorm());
+}
+
+// Automatic re-referencing: glitched pixels are rendered again against a new
+// reference orbit taken from among them, until none are left or
+// maxReferences orbits were used in the frame. Returns the number of extra
+// references computed.
+inline int fixGlitches(TileThreadPool& pool, const FrameTarget& target, FrameParams frame, int fractionLimbs, PixelList& glitches, std::vector<KernelStats>& workerStats) {
+    const int maxReferences = 16;
+    const int pixelsPerJob = 1024;
+
+    int references = 0;
+    while (!glitches.empty() && references + 1 < maxReferences && !frame.isCancelled()) {
+        // Glitches form blobs around orbits the old reference cannot follow,
+        // a pixel from the middle of the list lies inside one of them. The new
+        // reference never glitches against itself, so every pass makes progress.
+        const auto [refX, refY] = glitches[glitches.size() / 2];
+        ReferenceOrbit orbit = computeReferenceOrbit(frame.exactPixel(refX, refY, fractionLimbs), frame.maxIterations, frame.options.bailoutNorm());
+        orbit.pixelX = refX;
+        orbit.pixelY = refY;
+        prepareSeries(orbit, frame);
+        frame.reference = &orbit;
+        ++references;
+
+        // The glitch list is dealt out to the pool as a glitches.size() x 1 "frame"
+        std::vector<PixelList> stillGlitched(pool.size());
+        pool.run(static_cast<int>(glitches.size()), 1, pixelsPerJob, [&](const Tile& tile, unsigned workerIndex) {
+            renderPixels(target, glitches, tile.x0, tile.x1, frame, workerStats[workerIndex], stillGlitched[workerIndex]);
+        });
+        glitches.clear();
+        for (const PixelList& list : stillGlitched) {
+            glitches.insert(glitches.end(), list.begin(), list.end());
+        }
+    }
+
+    // Out of references: iterate what is left directly, in double-double when
+    // it resolves the frame and in BigFixed otherwise
+    const bool doubleDouble = precisionTierForSpacing(frame.pixelSpacing(), frame.view.center, frame.maxIterations, false) == PrecisionTier::DoubleDouble;
+    pool.run(static_cast<int>(glitches.size()), 1, doubleDouble ? pixelsPerJob / 8 : pixelsPerJob / 64, [&](const Tile& tile, unsigned workerIndex) {
+        if (frame.isCancelled()) return;
+        for (int i = tile.x0; i < tile.x1; ++i) {
+            const auto [x, y] = glitches[i];
+            const BigComplex c = frame.exactPixel(x, y, fractionLimbs);
+            double norm = 0.0;
+            const int iteration = doubleDouble ? mandelbrotIterationCount(DoubleDouble::fromBigFixed(c.real), DoubleDouble::fromBigFixed(c.imag), frame.maxIterations, frame.options,
+                                                                          &workerStats[workerIndex], &norm)
+                                               : mandelbrotIterationCount(c, frame.maxIterations, frame.options, &norm);
+            storeSample(target, x, y, pixelValue(iteration, norm, frame), frame);
+        }
+    });
+    return references;
+}
+
+// Move the contents of the target buffers so that pixel (x, y) gets the value
+// of pixel (x + shiftX, y + shiftY). Pixels shifted in from outside keep
+// stale values. Returns the exposed strips that need rendering, a full-width
+// row strip and a column strip without the rows of the first.
+inline std::vector<Tile> shiftFrame(const FrameTarget& target, int width, int height, int shiftX, int shiftY) {
+    if (std::abs(shiftX) >= width || std::abs(shiftY) >= height) return {{0, 0, width, height}};
+    const auto shiftBuffer = [&](auto* buffer, int channels) {
+        if (!buffer) return;
+        const size_t rowLength = static_cast<size_t>(width - std::abs(shiftX)) * channels;
+        const int sourceX = std::max(shiftX, 0);
+        const int destinationX = std::max(-shiftX, 0);
+        // Walk rows against the shift so no source row is overwritten before it is copied
+        for (int i = 0; i < height - std::abs(shiftY); ++i) {
+            const int y = shiftY > 0 ? i : height - 1 - i;
+            const size_t destination = (static_cast<size_t>(y) * width + destinationX) * channels;
+            const size_t source = (static_cast<size_t>(y + shiftY) * width + sourceX) * channels;
+            std::memmove(buffer + destination, buffer + source, rowLength * sizeof(*buffer));
+        }
+    };
+    shiftBuffer(target.iterations, 1);
+    shiftBuffer(target.smoothIterations, 1);
+    shiftBuffer(target.rgba, 4);
+
+    std::vector<Tile> exposed;
+    int rowsY0 = 0;
+    int rowsY1 = height;
+    if (shiftY > 0) {
+        exposed.push_back({0, height - shiftY, width, height});
+        rowsY1 = height - shiftY;
+    } else if (shiftY < 0) {
+        exposed.push_back({0, 0, width, -shiftY});
+        rowsY0 = -shiftY;
+    }
+    if (shiftX > 0) {
+        exposed.push_back({width - shiftX, rowsY0, width, rowsY1});
+    } else if (shiftX < 0) {
+        exposed.push_back({0, rowsY0, -shiftX, rowsY1});
+    }
+    return exposed;
+}
+
+// Pixels per job of the histogram and coloring passes
+constexpr int pixelsPerColorJob = 1 << 16;
+
+// Histogram of count iteration counts (clamped to 0..maxIterations) on the
+// pool. Each worker fills its own partial histogram, allocated by the first
+// chunk it takes; the partials are then merged by bin ranges, each range by
+// one worker. No locks or atomics on the bins.
+inline std::vector<std::uint64_t> iterationHistogram(TileThreadPool& pool, const int* iterations, size_t count, int maxIterations) {
+    const int bins = maxIterations + 1;
+    const int binsPerJob = 4096;
+    // Neighbouring pixels mostly share their count, so increments of the same
+    // bin would wait on each other: every partial has `ways` counters per bin,
+    // taken in turn by consecutive pixels
+    constexpr int ways = 4;
+    std::vector<std::vector<std::uint32_t>> partials(pool.size());
+    pool.run(static_cast<int>(count), 1, pixelsPerColorJob, [&](const Tile& tile, unsigned workerIndex) {
+        std::vector<std::uint32_t>& partial = partials[workerIndex];
+        if (partial.empty()) partial.assign(static_cast<size_t>(bins) * ways, 0);
+        std::uint32_t* counters = partial.data();
+        int i = tile.x0;
+        for (; i + ways <= tile.x1; i += ways) {
+            for (int way = 0; way < ways; ++way) {
+                ++counters[ways * std::min(std::max(iterations[i + way], 0), maxIterations) + way];
+            }
+        }
+        for (; i < tile.x1; ++i) {
+            ++counters[ways * std::min(std::max(iterations[i], 0), maxIterations)];
+        }
+    });
+    std::vector<std::uint64_t> histogram(bins);
+    pool.run(bins, 1, binsPerJob, [&](const Tile& tile, unsigned) {
+        for (const std::vector<std::uint32_t>& partial : partials) {
+            if (partial.empty()) continue;
+            for (int bin = tile.x0; bin < tile.x1; ++bin) {
+                for (int way = 0; way < ways; ++way) {
+                    histogram[bin] += partial[static_cast<size_t>(ways) * bin + way];
+                }
+            }
+        }
+    });
+    return histogram;
+}
+
+// colorizeIterations in chunks on the pool
+inline void colorizeFrame(TileThreadPool& pool, const int* iterations, size_t count, const PaletteTable& table, std::uint8_t* rgba) {
+    pool.run(static_cast<int>(count), 1, pixelsPerColorJob, [&](const Tile& tile, unsigned) {
+        colorizeIterations(iterations + tile.x0, tile.x1 - tile.x0, table, rgba + 4 * static_cast<size_t>(tile.x0));
+    });
+}
+
+// Render frame into target (frame.width x frame.height, rows from the top) on
+// the pool, only within regions when given. The cycle detection tolerance and
+// the precision tier are derived from the zoom here. Sampled (progressive)
+// passes always go through renderSection, subdivision needs every pixel of
+// its rectangles. A cancelled frame stops at the next tile.
+// Histogram coloring needs every count of the frame: the counts are rendered
+// first (into an internal buffer without an iterations target, which then
+// covers the whole frame) and equalized and colored once they are final.
+inline FrameResult renderFrame(TileThreadPool& pool, FrameTarget target, FrameParams frame, RenderMode renderMode, std::vector<Tile> regions = {}) {
+    const int tileSize = 32;
+    frame.options.periodicityTolerance = periodicityToleranceForSpacing(frame.pixelSpacing());
+    const size_t pixelCount = static_cast<size_t>(frame.width) * frame.height;
+    std::uint8_t* equalizedRgba = nullptr;
+    std::vector<int> histogramCounts;
+    if (target.rgba && frame.coloring == Coloring::Histogram) {
+        equalizedRgba = std::exchange(target.rgba, nullptr);
+        if (!target.iterations) {
+            histogramCounts.resize(pixelCount);
+            target.iterations = histogramCounts.data();
+            frame.previousStep = 0;
+            regions.clear();
+        }
+    }
+    PaletteTable paletteTable;
+    if (target.rgba) {
+        paletteTable = makePaletteTable(frame.palette, frame.maxIterations);
+        frame.paletteTable = &paletteTable;
+    }
+    frame.continuous = target.smoothIterations || (target.rgba && frame.coloring == Coloring::Smooth);
+    frame.smoothScale = SmoothCountScale(frame.options);
+
+    // Cheapest arithmetic that resolves the zoom. Perturbation and the exact
+    // kernel only exist for z^2, Multibrot sets stop at double-double, and so
+    // do frames that asked for no perturbation.
+    FrameResult result;
+    const bool perturbation = frame.perturbation && frame.options.power == 2;
+    result.tier = precisionTierForSpacing(frame.pixelSpacing(), frame.view.center, frame.maxIterations, perturbation);
+    if (result.tier == PrecisionTier::Exact) result.tier = PrecisionTier::DoubleDouble;
+    const int fractionLimbs = fractionLimbsForSpacing(frame.pixelSpacing());
+    if (result.tier == PrecisionTier::DoubleDouble) {
+        const BigComplex center = frame.view.exactCenter(fractionLimbs);
+        frame.doubleDouble = true;
+        frame.centerReal = DoubleDouble::fromBigFixed(center.real);
+        frame.centerImag = DoubleDouble::fromBigFixed(center.imag);
+    }
+
+    // Deep zoom: iterate pixels as deltas against a reference orbit at the
+    // view center, computed in as many bits as the zoom needs
+    const bool deepZoom = result.tier == PrecisionTier::Perturbation;
+    ReferenceOrbit centerOrbit;
+    if (deepZoom && !frame.isCancelled()) {
+        centerOrbit = computeReferenceOrbit(frame.view.exactCenter(fractionLimbs), frame.maxIterations, frame.options.bailoutNorm());
+        centerOrbit.pixelX = 0.5 * frame.width;
+        centerOrbit.pixelY = 0.5 * frame.height;
+        prepareSeries(centerOrbit, frame);
+        frame.reference = &centerOrbit;
+    }
+
+    // One counter block and glitch list per worker, merged once the frame is done
+    std::vector<KernelStats> workerStats(pool.size());
+    std::vector<PixelList> workerGlitches(pool.size());
+    // Equalized colors are only final at the very end
+    const bool tileHooks = frame.tileDone && !equalizedRgba;
+    if (regions.empty()) regions.push_back({0, 0, frame.width, frame.height});
+    for (const Tile& region : regions) {
+        // Tiles of the region, relative to its corner
+        pool.run(region.x1 - region.x0, region.y1 - region.y0, tileSize, [&](const Tile& tile, unsigned workerIndex) {
+            if (frame.isCancelled()) return;
+            const size_t glitchCount = workerGlitches[workerIndex].size();
+            const int x0 = region.x0 + tile.x0;
+            const int x1 = region.x0 + tile.x1;
+            const int y0 = region.y0 + tile.y0;
+            const int y1 = region.y0 + tile.y1;
+            if (renderMode == RenderMode::Subdivision && frame.sampleStep == 1) {
+                renderSectionSubdivided(target, x0, x1, y0, y1, frame, workerStats[workerIndex], workerGlitches[workerIndex]);
+            } else {
+                renderSection(target, x0, x1, y0, y1, frame, workerStats[workerIndex], workerGlitches[workerIndex]);
+            }
+            // Tiles with glitches are final once the glitches are fixed
+            if (tileHooks && workerGlitches[workerIndex].size() == glitchCount) frame.tileDone(x0, y0, x1, y1);
+        });
+    }
+    if (deepZoom && !frame.isCancelled()) {
+        PixelList glitches;
+        for (const PixelList& list : workerGlitches) {
+            glitches.insert(glitches.end(), list.begin(), list.end());
+        }
+        result.references = 1 + fixGlitches(pool, target, frame, fractionLimbs, glitches, workerStats);
+        if (tileHooks && !frame.isCancelled()) frame.tileDone(0, 0, frame.width, frame.height);
+    }
+    if (equalizedRgba && !frame.isCancelled()) {
+        const PaletteTable equalized = makeEqualizedPaletteTable(frame.palette, iterationHistogram(pool, target.iterations, pixelCount, frame.maxIterations));
+        colorizeFrame(pool, target.iterations, pixelCount, equalized, equalizedRgba);
+        if (frame.tileDone) frame.tileDone(0, 0, frame.width, frame.height);
+    }
+    for (const KernelStats& stats : workerStats) {
+        result.stats += stats;
+    }
+    result.cancelled = frame.isCancelled();
+    return result;
+}
+
+#endif
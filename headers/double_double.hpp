@@ -0,0 +1,108 @@
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <limits>
+
+#ifndef DOUBLE_DOUBLE_HPP
+#define DOUBLE_DOUBLE_HPP
+
+// Local
+#include "big_fixed.hpp"
+
+// Unevaluated sum hi + lo of two doubles with |lo| <= ulp(hi) / 2, about 106
+// significant bits. Built on error-free transforms, so it costs a handful of
+// double operations per operation instead of BigFixed limb loops.
+// Must not be compiled with -ffast-math, which would optimise the error terms
+// away.
+struct DoubleDouble {
+    double hi = 0.0;
+    double lo = 0.0;
+
+    DoubleDouble() = default;
+    DoubleDouble(double value) : hi(value) {}
+    DoubleDouble(double hi, double lo) : hi(hi), lo(lo) {}
+
+    // Nearest double-double to an exact value
+    static DoubleDouble fromBigFixed(const BigFixed& value) {
+        const double hi = value.toDouble();
+        const double lo = (value - BigFixed::fromDouble(hi, value.fractionLimbs())).toDouble();
+        return {hi, lo};
+    }
+
+    double toDouble() const { return hi + lo; }
+
+    // a + b = s + err exactly (Knuth), for any a and b
+    static DoubleDouble twoSum(double a, double b) {
+        const double s = a + b;
+        const double bb = s - a;
+        return {s, (a - (s - bb)) + (b - bb)};
+    }
+
+    // Same as twoSum, requires |a| >= |b|
+    static DoubleDouble quickTwoSum(double a, double b) {
+        const double s = a + b;
+        return {s, b - (s - a)};
+    }
+
+    // a * b = p + err exactly, the error term comes from a fused multiply-add
+    static DoubleDouble twoProd(double a, double b) {
+        const double p = a * b;
+        return {p, std::fma(a, b, -p)};
+    }
+
+    DoubleDouble operator-() const { return {-hi, -lo}; }
+
+    friend DoubleDouble operator+(const DoubleDouble& a, const DoubleDouble& b) {
+        DoubleDouble s = twoSum(a.hi, b.hi);
+        const DoubleDouble t = twoSum(a.lo, b.lo);
+        s.lo += t.hi;
+        s = quickTwoSum(s.hi, s.lo);
+        s.lo += t.lo;
+        return quickTwoSum(s.hi, s.lo);
+    }
+
+    friend DoubleDouble operator-(const DoubleDouble& a, const DoubleDouble& b) {
+        return a + -b;
+    }
+
+    friend DoubleDouble operator*(const DoubleDouble& a, const DoubleDouble& b) {
+        DoubleDouble p = twoProd(a.hi, b.hi);
+        p.lo += a.hi * b.lo + a.lo * b.hi;
+        return quickTwoSum(p.hi, p.lo);
+    }
+
+    DoubleDouble square() const {
+        DoubleDouble p = twoProd(hi, hi);
+        p.lo += 2.0 * hi * lo;
+        return quickTwoSum(p.hi, p.lo);
+    }
+
+    // 2 * this, exact
+    DoubleDouble doubled() const { return {2.0 * hi, 2.0 * lo}; }
+
+    DoubleDouble& operator+=(const DoubleDouble& other) { return *this = *this + other; }
+    DoubleDouble& operator-=(const DoubleDouble& other) { return *this = *this - other; }
+};
+
+// Unit roundoff of the arithmetic types, the relative error of one operation
+constexpr double doubleRoundoff = std::numeric_limits<double>::epsilon() / 2;
+constexpr double doubleDoubleRoundoff = doubleRoundoff * doubleRoundoff * 2;
+constexpr double floatRoundoff = std::numeric_limits<float>::epsilon() / 2;
+
+// Whether arithmetic with the given unit roundoff resolves pixels of the given
+// spacing around center for orbits of up to maxIterations steps. The pixel
+// spacing has to stay above a reserve of 1000 n^1.5 roundoffs of the center.
+// The reserve is fitted to measurements of double against perturbation and
+// the exact kernel: double first got more than 2% of a frame wrong below
+// 3e5 roundoffs near the antenna tip (100 to 500 iterations), 7e6 in the
+// elephant valley (1000) and 2e7 in the seahorse valley (2000 to 5000). The
+// fit stays at least 3 times above each of them. Longer orbits reach deeper
+// into near-parabolic regions, which is why the reserve grows faster than
+// the error of a single orbit, under two roundoffs of c for 99% of orbits.
+inline bool precisionCoversSpacing(double unitRoundoff, double pixelSpacing, const std::complex<double>& center, int maxIterations) {
+    const double iterations = std::max(1, maxIterations);
+    const double reserve = 1000.0 * iterations * std::sqrt(iterations);
+    return pixelSpacing >= reserve * unitRoundoff * std::max(1.0, std::abs(center));
+}
+
+#endif
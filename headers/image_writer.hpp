@@ -0,0 +1,96 @@
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifndef IMAGE_WRITER_HPP
+#define IMAGE_WRITER_HPP
+
+// Minimal image file writers for RGBA buffers (4 bytes per pixel, rows from
+// the top), without any image library. Errors are reported on std::cerr.
+
+// Binary PPM (P6), the alpha channel is dropped
+inline bool writePpm(const std::string& path, const std::uint8_t* pixels, int width, int height) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Cannot open " << path << " for writing" << "\n";
+        return false;
+    }
+    file << "P6\n" << width << " " << height << "\n255\n";
+    std::vector<char> row(static_cast<size_t>(width) * 3);
+    for (int y = 0; y < height; ++y) {
+        const std::uint8_t* source = pixels + static_cast<size_t>(y) * width * 4;
+        for (int x = 0; x < width; ++x) {
+            row[3 * x] = static_cast<char>(source[4 * x]);
+            row[3 * x + 1] = static_cast<char>(source[4 * x + 1]);
+            row[3 * x + 2] = static_cast<char>(source[4 * x + 2]);
+        }
+        file.write(row.data(), static_cast<std::streamsize>(row.size()));
+    }
+    return static_cast<bool>(file);
+}
+
+// Uncompressed 24-bit BMP, which every image viewer opens
+inline bool writeBmp(const std::string& path, const std::uint8_t* pixels, int width, int height) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Cannot open " << path << " for writing" << "\n";
+        return false;
+    }
+    // Rows are padded to a multiple of 4 bytes
+    const std::uint32_t rowSize = (static_cast<std::uint32_t>(width) * 3 + 3) & ~3u;
+    const std::uint32_t headerSize = 14 + 40;
+    const std::uint32_t fileSize = headerSize + rowSize * static_cast<std::uint32_t>(height);
+    const auto put16 = [&](std::uint16_t value) {
+        const char bytes[2] = {static_cast<char>(value), static_cast<char>(value >> 8)};
+        file.write(bytes, 2);
+    };
+    const auto put32 = [&](std::uint32_t value) {
+        const char bytes[4] = {static_cast<char>(value), static_cast<char>(value >> 8), static_cast<char>(value >> 16), static_cast<char>(value >> 24)};
+        file.write(bytes, 4);
+    };
+    // File header
+    file.write("BM", 2);
+    put32(fileSize);
+    put32(0);
+    put32(headerSize);
+    // BITMAPINFOHEADER, a negative height stores the rows top down
+    put32(40);
+    put32(static_cast<std::uint32_t>(width));
+    put32(static_cast<std::uint32_t>(-height));
+    put16(1);
+    put16(24);
+    put32(0);
+    put32(rowSize * static_cast<std::uint32_t>(height));
+    put32(2835); // 72 dpi
+    put32(2835);
+    put32(0);
+    put32(0);
+
+    std::vector<char> row(rowSize, 0);
+    for (int y = 0; y < height; ++y) {
+        const std::uint8_t* source = pixels + static_cast<size_t>(y) * width * 4;
+        for (int x = 0; x < width; ++x) {
+            // BMP stores BGR
+            row[3 * x] = static_cast<char>(source[4 * x + 2]);
+            row[3 * x + 1] = static_cast<char>(source[4 * x + 1]);
+            row[3 * x + 2] = static_cast<char>(source[4 * x]);
+        }
+        file.write(row.data(), static_cast<std::streamsize>(row.size()));
+    }
+    return static_cast<bool>(file);
+}
+
+// Write pixels in the format given by the extension of path (.ppm or .bmp)
+inline bool writeImage(const std::string& path, const std::uint8_t* pixels, int width, int height) {
+    const auto endsWith = [&](const std::string& suffix) {
+        return path.size() >= suffix.size() && path.compare(path.size() - suffix.size(), suffix.size(), suffix) == 0;
+    };
+    if (endsWith(".ppm")) return writePpm(path, pixels, width, height);
+    if (endsWith(".bmp")) return writeBmp(path, pixels, width, height);
+    std::cerr << "Unsupported image format: " << path << " (use .ppm or .bmp)" << "\n";
+    return false;
+}
+
+#endif
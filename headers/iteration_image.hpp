@@ -0,0 +1,118 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#ifndef ITERATION_IMAGE_HPP
+#define ITERATION_IMAGE_HPP
+
+// Raw iteration counts of a frame, stored as reference images to check that
+// optimized render paths do not change any pixel.
+
+struct IterationImage {
+    int width = 0;
+    int height = 0;
+    int maxIterations = 0;
+    // Rows from the top, pixel (x, y) at y * width + x
+    std::vector<int> iterations;
+};
+
+// File layout: "MITR", then width, height, maxIterations and every count as
+// 32-bit little endian integers
+inline bool writeIterationImage(const std::string& path, const IterationImage& image) {
+    std::ofstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Cannot open " << path << " for writing" << "\n";
+        return false;
+    }
+    const auto put32 = [&](std::uint32_t value) {
+        const char bytes[4] = {static_cast<char>(value), static_cast<char>(value >> 8), static_cast<char>(value >> 16), static_cast<char>(value >> 24)};
+        file.write(bytes, 4);
+    };
+    file.write("MITR", 4);
+    put32(static_cast<std::uint32_t>(image.width));
+    put32(static_cast<std::uint32_t>(image.height));
+    put32(static_cast<std::uint32_t>(image.maxIterations));
+    for (int count : image.iterations) {
+        put32(static_cast<std::uint32_t>(count));
+    }
+    return static_cast<bool>(file);
+}
+
+inline bool readIterationImage(const std::string& path, IterationImage& image) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file) {
+        std::cerr << "Cannot open " << path << "\n";
+        return false;
+    }
+    const auto get32 = [&]() {
+        unsigned char bytes[4] = {};
+        file.read(reinterpret_cast<char*>(bytes), 4);
+        return static_cast<std::uint32_t>(bytes[0]) | static_cast<std::uint32_t>(bytes[1]) << 8 | static_cast<std::uint32_t>(bytes[2]) << 16 |
+               static_cast<std::uint32_t>(bytes[3]) << 24;
+    };
+    char magic[4] = {};
+    file.read(magic, 4);
+    if (!file || std::string(magic, 4) != "MITR") {
+        std::cerr << path << " is not an iteration image" << "\n";
+        return false;
+    }
+    image.width = static_cast<int>(get32());
+    image.height = static_cast<int>(get32());
+    image.maxIterations = static_cast<int>(get32());
+    if (!file || image.width <= 0 || image.height <= 0 || image.width > 100000 || image.height > 100000) {
+        std::cerr << path << " has an invalid header" << "\n";
+        return false;
+    }
+    image.iterations.resize(static_cast<size_t>(image.width) * image.height);
+    for (int& count : image.iterations) {
+        count = static_cast<int>(get32());
+    }
+    if (!file) {
+        std::cerr << path << " is truncated" << "\n";
+        return false;
+    }
+    return true;
+}
+
+// Where and by how much two iteration images of the same size differ
+struct IterationDiff {
+    std::uint64_t differingPixels = 0;
+    std::uint64_t totalPixels = 0;
+    // Largest absolute difference of a count
+    int maxDifference = 0;
+    // Bounding box of the differing pixels, valid when differingPixels > 0
+    int minX = 0, minY = 0, maxX = 0, maxY = 0;
+    // First differing pixel in row order
+    int firstX = 0, firstY = 0;
+    int firstExpected = 0, firstActual = 0;
+};
+
+inline IterationDiff compareIterationImages(const IterationImage& expected, const IterationImage& actual) {
+    IterationDiff diff;
+    diff.totalPixels = expected.iterations.size();
+    for (int y = 0; y < expected.height; ++y) {
+        for (int x = 0; x < expected.width; ++x) {
+            const size_t index = static_cast<size_t>(y) * expected.width + x;
+            const int difference = std::abs(expected.iterations[index] - actual.iterations[index]);
+            if (difference == 0) continue;
+            if (diff.differingPixels == 0) {
+                diff.minX = diff.maxX = diff.firstX = x;
+                diff.minY = diff.maxY = diff.firstY = y;
+                diff.firstExpected = expected.iterations[index];
+                diff.firstActual = actual.iterations[index];
+            }
+            ++diff.differingPixels;
+            diff.maxDifference = std::max(diff.maxDifference, difference);
+            diff.minX = std::min(diff.minX, x);
+            diff.maxX = std::max(diff.maxX, x);
+            diff.maxY = y;
+        }
+    }
+    return diff;
+}
+
+#endif
@@ -0,0 +1,412 @@
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#ifndef MANDELBROT_CORE_HPP
+#define MANDELBROT_CORE_HPP
+
+// Local
+#include "mandelbrot_kernel.hpp"
+#include "perturbation.hpp"
+#include "utils.hpp"
+#include "viewport.hpp"
+
+// Public API of the mandelbrot_core library: a viewport goes in, an
+// iteration and / or RGBA buffer comes out. Plain C++, no SFML or GL, so it
+// can be embedded in services and benchmarks without a display.
+
+// 8-bit RGB color of a pixel
+struct PixelColor {
+    std::uint8_t r;
+    std::uint8_t g;
+    std::uint8_t b;
+};
+
+// Color schemes of the CPU renderer
+enum class Palette { Gradient, Grayscale, Smooth, Random };
+
+inline const char* paletteName(Palette palette) {
+    switch (palette) {
+        case Palette::Grayscale: return "grayscale";
+        case Palette::Smooth: return "smooth";
+        case Palette::Random: return "random";
+        default: return "gradient";
+    }
+}
+
+// Palette by name, false for unknown names
+inline bool parsePalette(const std::string& name, Palette& palette) {
+    for (Palette candidate : {Palette::Gradient, Palette::Grayscale, Palette::Smooth, Palette::Random}) {
+        if (name == paletteName(candidate)) {
+            palette = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Entries of the colormaps behind the Grayscale, Smooth and Random palettes
+constexpr int paletteColormapSize = 256;
+
+// RGB colormap of a palette (3 floats per color), generated once by the same
+// functions that fill the colormap texture of the shaders
+inline const std::vector<float>& paletteColormap(Palette palette) {
+    static const std::vector<float> grayscale = generate_grayscale_colormap(paletteColormapSize);
+    static const std::vector<float> smooth = generate_smooth_colormap(paletteColormapSize);
+    static const std::vector<float> random = generate_random_colormap(paletteColormapSize);
+    switch (palette) {
+        case Palette::Grayscale: return grayscale;
+        case Palette::Random: return random;
+        default: return smooth;
+    }
+}
+
+// Color at position t in [0, 1] along palette
+inline PixelColor paletteColorAt(Palette palette, double t) {
+    if (palette == Palette::Gradient) {
+        int r, g, b;
+
+        // Example gradient: from blue to red
+        r = (int)(9*(1-t)*t*t*t*255);
+        g = (int)(15*(1-t)*t*t*t*255);
+        b = (int)(8.5*(1-t)*t*t*t*255);
+
+        return {static_cast<std::uint8_t>(r), static_cast<std::uint8_t>(g), static_cast<std::uint8_t>(b)};
+    }
+    const int entry = std::clamp(static_cast<int>(t * (paletteColormapSize - 1)), 0, paletteColormapSize - 1);
+    const float* rgb = paletteColormap(palette).data() + 3 * entry;
+    // The random colormap goes above 1 towards its end
+    const auto channel = [](float value) { return static_cast<std::uint8_t>(std::clamp(255.0f * value, 0.0f, 255.0f)); };
+    return {channel(rgb[0]), channel(rgb[1]), channel(rgb[2])};
+}
+
+// Generate a color map based on the number of iterations
+inline PixelColor getColor(int iteration, int maxIterations) {
+    return paletteColorAt(Palette::Gradient, (double)iteration / (double)maxIterations);
+}
+
+inline PixelColor paletteColor(Palette palette, int iteration, int maxIterations) {
+    if (palette == Palette::Gradient) return getColor(iteration, maxIterations);
+    // Points inside the set are black
+    if (iteration >= maxIterations) return {0, 0, 0};
+    // Grayscale runs linearly, the others on a log scale like the shaders
+    const double t = palette == Palette::Grayscale ? static_cast<double>(iteration) / maxIterations
+                     : iteration > 0                ? std::log(static_cast<double>(iteration)) / std::log(static_cast<double>(maxIterations))
+                                                    : 0.0;
+    return paletteColorAt(palette, t);
+}
+
+// Palette as a lookup table: the RGBA bytes of every iteration count
+// 0..maxIterations packed into one word. Built once per palette and frame,
+// coloring a pixel is then a single table load (two and a fixed-point blend
+// for continuous counts), without any floating point math.
+struct PaletteTable {
+    int maxIterations = 0;
+    std::vector<std::uint32_t> colors;
+};
+
+// Table of palette for counts up to maxIterations. cycle moves the colors of
+// escaped points along the palette (color cycling), interior points keep
+// theirs.
+inline PaletteTable makePaletteTable(Palette palette, int maxIterations, int cycle = 0) {
+    PaletteTable table;
+    table.maxIterations = maxIterations;
+    table.colors.resize(static_cast<size_t>(maxIterations) + 1);
+    const int period = std::max(maxIterations, 1);
+    const int shift = (cycle % period + period) % period;
+    for (int iteration = 0; iteration <= maxIterations; ++iteration) {
+        const int source = iteration < maxIterations ? (iteration + shift) % period : iteration;
+        const PixelColor color = paletteColor(palette, source, maxIterations);
+        const std::uint8_t bytes[4] = {color.r, color.g, color.b, 255};
+        std::memcpy(&table.colors[iteration], bytes, 4);
+    }
+    return table;
+}
+
+// Color of a continuous count (smoothFractionBits fraction bits, see
+// smoothIterationCount): the table colors of its count and the next one,
+// blended by the fraction. Two channels per 32-bit multiply. Escaped counts
+// never blend into the interior color.
+inline std::uint32_t smoothColor(const PaletteTable& table, int smoothIteration) {
+    const int value = std::clamp(smoothIteration, 0, table.maxIterations << smoothFractionBits);
+    const int index = value >> smoothFractionBits;
+    const std::uint32_t weight = static_cast<std::uint32_t>(value) & ((1u << smoothFractionBits) - 1);
+    const std::uint32_t from = table.colors[index];
+    const std::uint32_t to = table.colors[index + 1 < table.maxIterations ? index + 1 : index];
+    const std::uint32_t mask = 0x00FF00FFu;
+    const std::uint32_t one = 1u << smoothFractionBits;
+    const std::uint32_t evenBytes = (((from & mask) * (one - weight) + (to & mask) * weight) >> smoothFractionBits) & mask;
+    const std::uint32_t oddBytes = (((from >> 8) & mask) * (one - weight) + ((to >> 8) & mask) * weight) & ~mask;
+    return evenBytes | oddBytes;
+}
+
+// Histogram equalization: escaped count n gets the palette color at the
+// share of escaped pixels with a lower count (plus half of its own), so every
+// part of the palette covers about as many pixels however the counts spread.
+// histogram[n] is the number of pixels with count n, the table is for counts
+// up to histogram.size() - 1 (maxIterations). Cycle it with
+// rotatePaletteTable.
+inline PaletteTable makeEqualizedPaletteTable(Palette palette, const std::vector<std::uint64_t>& histogram) {
+    PaletteTable table;
+    table.maxIterations = std::max(static_cast<int>(histogram.size()) - 1, 0);
+    table.colors.resize(static_cast<size_t>(table.maxIterations) + 1);
+    std::uint64_t escaped = 0;
+    for (int iteration = 0; iteration < table.maxIterations; ++iteration) {
+        escaped += histogram[iteration];
+    }
+    std::uint64_t below = 0;
+    for (int iteration = 0; iteration <= table.maxIterations; ++iteration) {
+        PixelColor color = paletteColor(palette, iteration, table.maxIterations);
+        if (iteration < table.maxIterations) {
+            const double share = escaped > 0 ? (static_cast<double>(below) + 0.5 * static_cast<double>(histogram[iteration])) / static_cast<double>(escaped) : 0.0;
+            color = paletteColorAt(palette, share);
+            below += histogram[iteration];
+        }
+        const std::uint8_t bytes[4] = {color.r, color.g, color.b, 255};
+        std::memcpy(&table.colors[iteration], bytes, 4);
+    }
+    return table;
+}
+
+// table with the colors of escaped counts moved cycle entries along, the
+// interior color kept. Same as makePaletteTable(palette, maxIterations,
+// cycle) for a table made with cycle 0, but without any palette math, so
+// color cycling a built table (equalized or not) is one copy.
+inline PaletteTable rotatePaletteTable(const PaletteTable& table, int cycle) {
+    PaletteTable rotated = table;
+    const int period = std::max(table.maxIterations, 1);
+    const int shift = (cycle % period + period) % period;
+    std::rotate(rotated.colors.begin(), rotated.colors.begin() + shift, rotated.colors.begin() + table.maxIterations);
+    return rotated;
+}
+
+namespace palette_simd {
+
+    inline void colorizeScalar(const int* iterations, size_t count, const PaletteTable& table, std::uint8_t* rgba) {
+        for (size_t i = 0; i < count; ++i) {
+            const int index = std::clamp(iterations[i], 0, table.maxIterations);
+            std::memcpy(rgba + 4 * i, &table.colors[index], 4);
+        }
+    }
+
+    inline void colorizeSmoothScalar(const int* smoothIterations, size_t count, const PaletteTable& table, std::uint8_t* rgba) {
+        for (size_t i = 0; i < count; ++i) {
+            const std::uint32_t color = smoothColor(table, smoothIterations[i]);
+            std::memcpy(rgba + 4 * i, &color, 4);
+        }
+    }
+
+#if MANDELBROT_KERNEL_X86
+    // 8 pixels per table gather
+    __attribute__((target("avx2")))
+    inline void colorizeAvx2(const int* iterations, size_t count, const PaletteTable& table, std::uint8_t* rgba) {
+        const __m256i first = _mm256_setzero_si256();
+        const __m256i last = _mm256_set1_epi32(table.maxIterations);
+        const int* colors = reinterpret_cast<const int*>(table.colors.data());
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            __m256i index = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(iterations + i));
+            index = _mm256_min_epi32(_mm256_max_epi32(index, first), last);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(rgba + 4 * i), _mm256_i32gather_epi32(colors, index, 4));
+        }
+        colorizeScalar(iterations + i, count - i, table, rgba + 4 * i);
+    }
+
+    // smoothColor on 8 pixels: two table gathers, the blend in 16-bit lanes
+    // that each hold one channel
+    __attribute__((target("avx2")))
+    inline void colorizeSmoothAvx2(const int* smoothIterations, size_t count, const PaletteTable& table, std::uint8_t* rgba) {
+        const __m256i first = _mm256_setzero_si256();
+        const __m256i last = _mm256_set1_epi32(table.maxIterations << smoothFractionBits);
+        const __m256i lastEscaped = _mm256_set1_epi32(std::max(table.maxIterations - 1, 0));
+        const __m256i fractionMask = _mm256_set1_epi32((1 << smoothFractionBits) - 1);
+        const __m256i one = _mm256_set1_epi16(1 << smoothFractionBits);
+        const __m256i mask = _mm256_set1_epi32(0x00FF00FF);
+        const int* colors = reinterpret_cast<const int*>(table.colors.data());
+        size_t i = 0;
+        for (; i + 8 <= count; i += 8) {
+            __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(smoothIterations + i));
+            value = _mm256_min_epi32(_mm256_max_epi32(value, first), last);
+            const __m256i index = _mm256_srli_epi32(value, smoothFractionBits);
+            // Next entry, except past the last escaped count
+            const __m256i next = _mm256_blendv_epi8(index, _mm256_add_epi32(index, _mm256_set1_epi32(1)), _mm256_cmpgt_epi32(lastEscaped, index));
+            const __m256i from = _mm256_i32gather_epi32(colors, index, 4);
+            const __m256i to = _mm256_i32gather_epi32(colors, next, 4);
+            // Weight in both 16-bit halves of every pixel
+            const __m256i fraction = _mm256_and_si256(value, fractionMask);
+            const __m256i weight = _mm256_or_si256(fraction, _mm256_slli_epi32(fraction, 16));
+            const __m256i inverse = _mm256_sub_epi16(one, weight);
+            const __m256i evenBytes = _mm256_srli_epi16(
+                    _mm256_add_epi16(_mm256_mullo_epi16(_mm256_and_si256(from, mask), inverse), _mm256_mullo_epi16(_mm256_and_si256(to, mask), weight)), smoothFractionBits);
+            const __m256i oddBytes = _mm256_andnot_si256(
+                    mask, _mm256_add_epi16(_mm256_mullo_epi16(_mm256_srli_epi16(from, 8), inverse), _mm256_mullo_epi16(_mm256_srli_epi16(to, 8), weight)));
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(rgba + 4 * i), _mm256_or_si256(evenBytes, oddBytes));
+        }
+        colorizeSmoothScalar(smoothIterations + i, count - i, table, rgba + 4 * i);
+    }
+#endif
+}
+
+// Colors of count iteration counts (e.g. from renderIterations) through
+// table, 4 bytes per pixel. Changing the palette or cycling colors only
+// needs this pass, not a new render.
+inline void colorizeIterations(const int* iterations, size_t count, const PaletteTable& table, std::uint8_t* rgba) {
+#if MANDELBROT_KERNEL_X86
+    if (activeKernelIsa() >= KernelIsa::AVX2) {
+        palette_simd::colorizeAvx2(iterations, count, table, rgba);
+        return;
+    }
+#endif
+    palette_simd::colorizeScalar(iterations, count, table, rgba);
+}
+
+// Same for continuous counts (e.g. the smoothIterations of renderIterations),
+// interpolated between neighbouring table entries, so no bands show
+inline void colorizeSmoothIterations(const int* smoothIterations, size_t count, const PaletteTable& table, std::uint8_t* rgba) {
+#if MANDELBROT_KERNEL_X86
+    if (activeKernelIsa() >= KernelIsa::AVX2) {
+        palette_simd::colorizeSmoothAvx2(smoothIterations, count, table, rgba);
+        return;
+    }
+#endif
+    palette_simd::colorizeSmoothScalar(smoothIterations, count, table, rgba);
+}
+
+// How iteration counts map to palette colors
+enum class Coloring { Banded, Smooth, Histogram };
+
+inline const char* coloringName(Coloring coloring) {
+    switch (coloring) {
+        case Coloring::Smooth: return "smooth";
+        case Coloring::Histogram: return "histogram";
+        default: return "banded";
+    }
+}
+
+// Coloring by name, false for unknown names
+inline bool parseColoring(const std::string& name, Coloring& coloring) {
+    for (Coloring candidate : {Coloring::Banded, Coloring::Smooth, Coloring::Histogram}) {
+        if (name == coloringName(candidate)) {
+            coloring = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Render modes of the CPU renderer
+enum class RenderMode { BruteForce, Subdivision };
+
+inline const char* renderModeName(RenderMode mode) {
+    return mode == RenderMode::Subdivision ? "subdivision" : "brute force";
+}
+
+// Everything that defines one image
+struct RenderRequest {
+    Viewport view;
+    int width = 0;
+    int height = 0;
+    // At most maxSmoothIterations, larger limits are clamped to it
+    int maxIterations = 200;
+    // Exponent, escape radius and interior test; the cycle detection
+    // tolerance is derived from the zoom by the renderer
+    KernelOptions options;
+    Palette palette = Palette::Gradient;
+    // Banded colors every count alike, Smooth blends by the continuous count,
+    // Histogram equalizes the counts of the frame over the palette
+    Coloring coloring = Coloring::Banded;
+    RenderMode renderMode = RenderMode::BruteForce;
+    // Deep zooms are iterated by perturbation against reference orbits. Off,
+    // they are iterated directly in double-double: much slower, but with no
+    // reference or glitch in the way, e.g. for reference images.
+    bool perturbation = true;
+    // Background rendering hooks, both optional and called on render threads.
+    // cancelled is polled before every tile: once it returns true the rest of
+    // the frame is skipped and the buffers are left partly rendered.
+    // tileDone reports pixels [x0, x1) x [y0, y1) that are final.
+    std::function<bool()> cancelled;
+    std::function<void(int x0, int y0, int x1, int y1)> tileDone;
+};
+
+// Outcome of a render, for status lines and reports
+struct FrameResult {
+    PrecisionTier tier = PrecisionTier::Double;
+    // Perturbation reference orbits used, 0 outside deep zooms
+    int references = 0;
+    KernelStats stats;
+    // Set when request.cancelled stopped the render early
+    bool cancelled = false;
+};
+
+// Sample steps of a progressive render, coarse to fine: 1/8 resolution
+// first, full resolution last
+constexpr int progressiveSteps[] = {8, 4, 2, 1};
+
+class TileThreadPool;
+
+// Multithreaded CPU renderer. Owns its worker threads, so keep one instance
+// alive across frames. Rows of every buffer run from the top, pixel (x, y) is
+// at index y * width + x. The real axis is not rotated with view.rotation.
+class MandelbrotRenderer {
+public:
+    // threadCount 0 uses every hardware thread
+    explicit MandelbrotRenderer(unsigned threadCount = 0);
+    ~MandelbrotRenderer();
+
+    MandelbrotRenderer(const MandelbrotRenderer&) = delete;
+    MandelbrotRenderer& operator=(const MandelbrotRenderer&) = delete;
+
+    unsigned threadCount() const;
+
+    // RGBA colors, 4 * width * height bytes
+    FrameResult render(const RenderRequest& request, std::uint8_t* rgba);
+
+    // Iteration counts (maxIterations for points inside the set), width *
+    // height ints, and optionally the RGBA colors and the continuous counts
+    // (smoothIterationCount, for colorizeSmoothIterations) in the same pass.
+    // Every buffer may be null.
+    FrameResult renderIterations(const RenderRequest& request, int* iterations, std::uint8_t* rgba = nullptr, int* smoothIterations = nullptr);
+
+    // One pass of a progressive render: computes every step-th pixel of each
+    // row and column and fills the step x step block right of and below it.
+    // Pixels the pass with previousStep (0 for none, else a multiple of step)
+    // computed into the same buffers are kept. Passes through
+    // progressiveSteps end with the buffers render() gives, the last one
+    // recomputes every pixel in subdivision mode. step divides 32.
+    FrameResult renderPass(const RenderRequest& request, int step, int previousStep, int* iterations, std::uint8_t* rgba, int* smoothIterations = nullptr);
+
+    // Incremental pan: the buffers hold the frame of the previous view, which
+    // had the same size, zoom and settings, and pixel (x, y) of request.view
+    // is pixel (x + shiftX, y + shiftY) of it (see ViewChange::snapToPixels).
+    // The buffers are shifted in place and only the exposed strips computed.
+    // Kept pixels were computed from the old center, a fresh render rounds its
+    // coordinates from the new one, so counts that flip under a one-ulp change
+    // of c may differ: chaotic pixels with long orbits (about 0.4% of a seahorse
+    // valley frame at 2000 iterations) and a row that was exactly on the real
+    // axis. Elsewhere the result is the frame render() gives.
+    FrameResult renderShifted(const RenderRequest& request, int shiftX, int shiftY, int* iterations, std::uint8_t* rgba, int* smoothIterations = nullptr);
+
+    // The shift of renderShifted alone, for other copies of the previous
+    // frame (e.g. the one on screen). The exposed strips keep stale values.
+    static void shiftFrame(int width, int height, int shiftX, int shiftY, int* iterations, std::uint8_t* rgba, int* smoothIterations = nullptr);
+
+    // Number of pixels per count 0..maxIterations among count iteration
+    // counts, for makeEqualizedPaletteTable. Built on the render threads:
+    // every worker counts into its own partial histogram, then the partials
+    // are summed range of bins by range of bins, so no bin is ever shared.
+    std::vector<std::uint64_t> iterationHistogram(const int* iterations, size_t count, int maxIterations);
+
+    // colorizeIterations on the render threads. Neither this nor
+    // iterationHistogram may run while the renderer renders a frame.
+    void colorize(const int* iterations, size_t count, const PaletteTable& table, std::uint8_t* rgba);
+
+private:
+    std::unique_ptr<TileThreadPool> pool;
+};
+
+#endif
@@ -0,0 +1,624 @@
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <utility>
+
+#ifndef MANDELBROT_KERNEL_HPP
+#define MANDELBROT_KERNEL_HPP
+
+// Local
+#include "big_fixed.hpp"
+#include "double_double.hpp"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define MANDELBROT_KERNEL_X86 1
+#include <immintrin.h>
+#else
+#define MANDELBROT_KERNEL_X86 0
+#endif
+
+// Instruction set used by the batched escape-time kernel
+enum class KernelIsa { Scalar, AVX2, AVX512 };
+
+inline const char* kernelIsaName(KernelIsa isa) {
+    switch (isa) {
+        case KernelIsa::AVX512: return "avx512";
+        case KernelIsa::AVX2: return "avx2";
+        default: return "scalar";
+    }
+}
+
+// Runtime switches of the escape-time kernel
+struct KernelOptions {
+    // Skip points of the main cardioid and the period-2 bulb, which are known
+    // to be inside the set, instead of running them for maxIterations
+    bool interiorCheck = true;
+    // Brent-style cycle detection: a point whose orbit comes back within this
+    // distance of a saved orbit point is declared interior. 0 turns it off.
+    double periodicityTolerance = 0.0;
+    // Exponent d of z -> z^d + c (2 is the Mandelbrot set, higher the
+    // Multibrot sets) and escape radius, both among the compiled-in
+    // kernelPowers / kernelBailoutRadii
+    int power = 2;
+    int bailoutRadius = 2;
+
+    // |z|^2 beyond which a point has escaped
+    double bailoutNorm() const { return static_cast<double>(bailoutRadius) * bailoutRadius; }
+};
+
+// Counters filled by the kernel, summed by the renderer over a frame
+struct KernelStats {
+    // Points declared interior by cycle detection
+    std::uint64_t periodicPoints = 0;
+    // Iterations those points did not have to run
+    std::uint64_t iterationsSaved = 0;
+    // Perturbed points that glitched and need another reference
+    std::uint64_t glitchedPoints = 0;
+    // Iterations replaced by the series approximation
+    std::uint64_t seriesSkipped = 0;
+
+    KernelStats& operator+=(const KernelStats& other) {
+        periodicPoints += other.periodicPoints;
+        iterationsSaved += other.iterationsSaved;
+        glitchedPoints += other.glitchedPoints;
+        seriesSkipped += other.seriesSkipped;
+        return *this;
+    }
+
+    // Points declared interior by cycle detection once stepsDone of
+    // maxIterations steps are done
+    void addPeriodic(int points, int stepsDone, int maxIterations) {
+        periodicPoints += static_cast<std::uint64_t>(points);
+        iterationsSaved += static_cast<std::uint64_t>(points) * static_cast<std::uint64_t>(maxIterations - stepsDone);
+    }
+};
+
+// Cycle detection tolerance for a given pixel spacing. Orbits have to close
+// far below one pixel, so points close to the boundary are not misclassified.
+inline double periodicityToleranceForSpacing(double pixelSpacing) {
+    return 1e-3 * pixelSpacing;
+}
+
+// Closed-form membership test for the main cardioid and the period-2 bulb
+inline bool inCardioidOrBulb(double real, double imag) {
+    const double xq = real - 0.25;
+    const double imag2 = imag * imag;
+    const double q = xq * xq + imag2;
+    if (q * (q + xq) <= 0.25 * imag2) return true;
+    const double xb = real + 1.0;
+    return xb * xb + imag2 <= 0.0625;
+}
+
+// Scalar types the kernel family is instantiated for
+enum class KernelScalar { Float, Double, LongDouble, DoubleDouble };
+
+inline const char* kernelScalarName(KernelScalar scalar) {
+    switch (scalar) {
+        case KernelScalar::Float: return "float";
+        case KernelScalar::LongDouble: return "long double";
+        case KernelScalar::DoubleDouble: return "double-double";
+        default: return "double";
+    }
+}
+
+// Exponents and escape radii the kernel family is compiled for
+constexpr int kernelPowers[] = {2, 3, 4, 5};
+constexpr int kernelBailoutRadii[] = {2, 256};
+
+// The few operations the kernel needs beyond + - *, with double-double
+// overloads that use its cheaper exact forms
+namespace mandelbrot_scalar {
+    // Leading double of a value, precise enough for the bailout and cycle tests
+    template <typename Scalar>
+    inline double lead(const Scalar& x) { return static_cast<double>(x); }
+    inline double lead(const DoubleDouble& x) { return x.hi; }
+
+    template <typename Scalar>
+    inline Scalar square(const Scalar& x) { return x * x; }
+    inline DoubleDouble square(const DoubleDouble& x) { return x.square(); }
+
+    template <typename Scalar>
+    inline Scalar twice(const Scalar& x) { return x + x; }
+    inline DoubleDouble twice(const DoubleDouble& x) { return x.doubled(); }
+
+    // origin + offset rounded to Scalar. Only double-double keeps the low
+    // part of the origin, the other types could not represent it anyway.
+    template <typename Scalar>
+    inline Scalar point(const DoubleDouble& origin, double offset) { return static_cast<Scalar>(origin.hi + offset); }
+    template <>
+    inline long double point<long double>(const DoubleDouble& origin, double offset) {
+        return static_cast<long double>(origin.hi) + (static_cast<long double>(origin.lo) + offset);
+    }
+    template <>
+    inline DoubleDouble point<DoubleDouble>(const DoubleDouble& origin, double offset) { return origin + offset; }
+
+    // z = z^Power by repeated squaring, unrolled at compile time
+    template <int Power, typename Scalar>
+    inline void complexPower(Scalar& zr, Scalar& zi) {
+        static_assert(Power >= 1, "complexPower needs a positive exponent");
+        if constexpr (Power % 2 == 0) {
+            complexPower<Power / 2>(zr, zi);
+            const Scalar real = square(zr) - square(zi);
+            zi = twice(zr) * zi;
+            zr = real;
+        } else if constexpr (Power > 1) {
+            const Scalar baseR = zr;
+            const Scalar baseI = zi;
+            complexPower<Power - 1>(zr, zi);
+            const Scalar real = zr * baseR - zi * baseI;
+            zi = zr * baseI + zi * baseR;
+            zr = real;
+        }
+    }
+}
+
+// Escape-time count of c = cr + i ci for z -> z^Power + c, with the scalar
+// type, exponent and escape radius fixed at compile time. The bailout compares
+// |z|^2 against the squared radius, so no sqrt (and no generic std::complex
+// multiply) is left in the loop. escapeNorm, when given, receives |z|^2 at
+// escape for smoothIterationCount.
+template <typename Scalar, int Power, int BailoutRadius>
+inline int escapeTimeCount(const Scalar& cr, const Scalar& ci, int maxIterations, const KernelOptions& options, KernelStats* stats, double* escapeNorm = nullptr) {
+    using namespace mandelbrot_scalar;
+    constexpr double bailout2 = static_cast<double>(BailoutRadius) * BailoutRadius;
+    // The closed-form interior test only describes the Mandelbrot set itself
+    if constexpr (Power == 2) {
+        if (options.interiorCheck && inCardioidOrBulb(lead(cr), lead(ci))) return maxIterations;
+    }
+    const double tolerance = options.periodicityTolerance;
+    Scalar zr = cr;
+    Scalar zi = ci;
+    // Orbit point the cycle check compares against, refreshed at powers of two
+    Scalar savedR = zr;
+    Scalar savedI = zi;
+    std::int64_t checkpoint = 1;
+    for (int i = 0; i < maxIterations; ++i) {
+        const Scalar zr2 = square(zr);
+        const Scalar zi2 = square(zi);
+        const double norm = lead(zr2) + lead(zi2);
+        if (norm > bailout2) {
+            if (escapeNorm) *escapeNorm = norm;
+            return i;
+        }
+        if constexpr (Power == 2) {
+            // The squares are needed for the bailout anyway
+            zi = twice(zr) * zi + ci;
+            zr = zr2 - zi2 + cr;
+        } else {
+            complexPower<Power>(zr, zi);
+            zr = zr + cr;
+            zi = zi + ci;
+        }
+        if (tolerance > 0.0) {
+            if (std::abs(lead(zr - savedR)) < tolerance && std::abs(lead(zi - savedI)) < tolerance) {
+                if (stats) stats->addPeriodic(1, i + 1, maxIterations);
+                return maxIterations;
+            }
+            if (i + 1 == checkpoint) {
+                savedR = zr;
+                savedI = zi;
+                checkpoint *= 2;
+            }
+        }
+    }
+    return maxIterations;
+}
+
+// Batched member of the family: `count` points given as double offsets from
+// a double-double origin (zero for plain coordinates). norms may be null,
+// otherwise it receives |z|^2 at escape of every point that escapes.
+template <typename Scalar, int Power, int BailoutRadius>
+inline void escapeTimeCounts(const DoubleDouble& originReal, const DoubleDouble& originImag, const double* real, const double* imag, int count, int maxIterations, const KernelOptions& options, int* iterations, KernelStats* stats, double* norms) {
+    for (int i = 0; i < count; ++i) {
+        const Scalar cr = mandelbrot_scalar::point<Scalar>(originReal, real[i]);
+        const Scalar ci = mandelbrot_scalar::point<Scalar>(originImag, imag[i]);
+        iterations[i] = escapeTimeCount<Scalar, Power, BailoutRadius>(cr, ci, maxIterations, options, stats, norms ? norms + i : nullptr);
+    }
+}
+
+using EscapeTimeKernel = void (*)(const DoubleDouble& originReal, const DoubleDouble& originImag, const double* real, const double* imag, int count, int maxIterations,
+                                  const KernelOptions& options, int* iterations, KernelStats* stats, double* norms);
+
+namespace mandelbrot_dispatch {
+    constexpr int scalarCount = 4;
+    constexpr int powerCount = static_cast<int>(std::size(kernelPowers));
+    constexpr int bailoutCount = static_cast<int>(std::size(kernelBailoutRadii));
+
+    constexpr int kernelsPerScalar = powerCount * bailoutCount;
+
+    // Every (power, bailout) pair of one scalar type, power major
+    template <typename Scalar, size_t... I>
+    constexpr std::array<EscapeTimeKernel, kernelsPerScalar> scalarKernels(std::index_sequence<I...>) {
+        return {&escapeTimeCounts<Scalar, kernelPowers[I / bailoutCount], kernelBailoutRadii[I % bailoutCount]>...};
+    }
+
+    template <typename Scalar>
+    constexpr std::array<EscapeTimeKernel, kernelsPerScalar> scalarKernels() {
+        return scalarKernels<Scalar>(std::make_index_sequence<kernelsPerScalar>());
+    }
+
+    // Indexed by [scalar][power * bailoutCount + bailout]
+    inline const std::array<std::array<EscapeTimeKernel, kernelsPerScalar>, scalarCount>& table() {
+        static constexpr std::array<std::array<EscapeTimeKernel, kernelsPerScalar>, scalarCount> kernels = {
+                scalarKernels<float>(), scalarKernels<double>(), scalarKernels<long double>(), scalarKernels<DoubleDouble>()};
+        return kernels;
+    }
+
+    constexpr int indexOf(const int* values, int count, int value) {
+        for (int i = 0; i < count; ++i) {
+            if (values[i] == value) return i;
+        }
+        return -1;
+    }
+}
+
+// Kernel of the family for a scalar type, exponent and escape radius, or
+// nullptr when that combination is not compiled in
+inline EscapeTimeKernel escapeTimeKernel(KernelScalar scalar, int power, int bailoutRadius) {
+    using namespace mandelbrot_dispatch;
+    const int p = indexOf(kernelPowers, powerCount, power);
+    const int b = indexOf(kernelBailoutRadii, bailoutCount, bailoutRadius);
+    if (p < 0 || b < 0) return nullptr;
+    return table()[static_cast<size_t>(scalar)][static_cast<size_t>(p * bailoutCount + b)];
+}
+
+// Iteration count of a single point with the exponent and escape radius of
+// options, run through the kernel family
+inline int mandelbrotIterationCount(double real, double imag, int maxIterations, const KernelOptions& options = KernelOptions(), KernelStats* stats = nullptr) {
+    int iterations = maxIterations;
+    if (EscapeTimeKernel kernel = escapeTimeKernel(KernelScalar::Double, options.power, options.bailoutRadius)) {
+        kernel(DoubleDouble(), DoubleDouble(), &real, &imag, 1, maxIterations, options, &iterations, stats, nullptr);
+    }
+    return iterations;
+}
+
+inline int mandelbrotIterationCount(const std::complex<double>& z0, int maxIterations, const KernelOptions& options = KernelOptions(), KernelStats* stats = nullptr) {
+    return mandelbrotIterationCount(z0.real(), z0.imag(), maxIterations, options, stats);
+}
+
+// Same count in BigFixed arithmetic, exact to the precision of c. Orders of
+// magnitude slower than double, meant for the few points that neither double
+// nor perturbation can resolve. z^2 only, the escape radius is taken from
+// options. |z| is tested before z is squared, like in computeReferenceOrbit:
+// the step after the last one inside R = 256 can reach |z| = 65536 + |c|,
+// whose square no longer fits the one integer limb of BigFixed.
+inline int mandelbrotIterationCount(const BigComplex& c, int maxIterations, const KernelOptions& options = KernelOptions(), double* escapeNorm = nullptr) {
+    const double bailoutNorm = options.bailoutNorm();
+    BigFixed zr = c.real;
+    BigFixed zi = c.imag;
+    for (int i = 0; i < maxIterations; ++i) {
+        const double r = zr.toDouble();
+        const double im = zi.toDouble();
+        const double norm = r * r + im * im;
+        if (norm > bailoutNorm) {
+            if (escapeNorm) *escapeNorm = norm;
+            return i;
+        }
+        BigFixed zr2 = zr.square();
+        zr2 -= zi.square();
+        zi = BigFixed::mulAdd(zr.doubled(), zi, c.imag);
+        zr = std::move(zr2);
+        zr += c.real;
+    }
+    return maxIterations;
+}
+
+// Same count in double-double arithmetic, for zooms just past the reach of
+// double
+inline int mandelbrotIterationCount(const DoubleDouble& real, const DoubleDouble& imag, int maxIterations, const KernelOptions& options = KernelOptions(), KernelStats* stats = nullptr,
+                                    double* escapeNorm = nullptr) {
+    int iterations = maxIterations;
+    if (EscapeTimeKernel kernel = escapeTimeKernel(KernelScalar::DoubleDouble, options.power, options.bailoutRadius)) {
+        const double zero = 0.0;
+        kernel(real, imag, &zero, &zero, 1, maxIterations, options, &iterations, stats, escapeNorm);
+    }
+    return iterations;
+}
+
+// Batched double-double form for `count` points given as double offsets from
+// a double-double origin (e.g. the view center), so only the origin has to be
+// carried in extended precision
+inline void mandelbrotIterationCounts(const DoubleDouble& originReal, const DoubleDouble& originImag, const double* real, const double* imag, int count, int maxIterations, const KernelOptions& options, int* iterations,
+                                      KernelStats* stats = nullptr, double* norms = nullptr) {
+    if (EscapeTimeKernel kernel = escapeTimeKernel(KernelScalar::DoubleDouble, options.power, options.bailoutRadius)) {
+        kernel(originReal, originImag, real, imag, count, maxIterations, options, iterations, stats, norms);
+    } else {
+        std::fill(iterations, iterations + count, maxIterations);
+    }
+}
+
+namespace mandelbrot_simd {
+
+    inline void iterationCountsScalar(const double* real, const double* imag, int count, int maxIterations, const KernelOptions& options, int* iterations, KernelStats* stats, double* norms) {
+        for (int i = 0; i < count; ++i) {
+            iterations[i] = escapeTimeCount<double, 2, 2>(real[i], imag[i], maxIterations, options, stats, norms ? norms + i : nullptr);
+        }
+    }
+
+#if MANDELBROT_KERNEL_X86
+    // Vector forms of inCardioidOrBulb, all ones / bit set for interior lanes
+    __attribute__((target("avx2,fma")))
+    inline __m256d cardioidOrBulbAvx2(__m256d cr, __m256d ci) {
+        const __m256d quarter = _mm256_set1_pd(0.25);
+        const __m256d one = _mm256_set1_pd(1.0);
+        const __m256d ci2 = _mm256_mul_pd(ci, ci);
+        const __m256d xq = _mm256_sub_pd(cr, quarter);
+        const __m256d q = _mm256_add_pd(_mm256_mul_pd(xq, xq), ci2);
+        const __m256d cardioid = _mm256_cmp_pd(_mm256_mul_pd(q, _mm256_add_pd(q, xq)), _mm256_mul_pd(quarter, ci2), _CMP_LE_OQ);
+        const __m256d xb = _mm256_add_pd(cr, one);
+        const __m256d bulb = _mm256_cmp_pd(_mm256_add_pd(_mm256_mul_pd(xb, xb), ci2), _mm256_set1_pd(0.0625), _CMP_LE_OQ);
+        return _mm256_or_pd(cardioid, bulb);
+    }
+
+    __attribute__((target("avx512f")))
+    inline __mmask8 cardioidOrBulbAvx512(__m512d cr, __m512d ci) {
+        const __m512d quarter = _mm512_set1_pd(0.25);
+        const __m512d one = _mm512_set1_pd(1.0);
+        const __m512d ci2 = _mm512_mul_pd(ci, ci);
+        const __m512d xq = _mm512_sub_pd(cr, quarter);
+        const __m512d q = _mm512_add_pd(_mm512_mul_pd(xq, xq), ci2);
+        const __mmask8 cardioid = _mm512_cmp_pd_mask(_mm512_mul_pd(q, _mm512_add_pd(q, xq)), _mm512_mul_pd(quarter, ci2), _CMP_LE_OQ);
+        const __m512d xb = _mm512_add_pd(cr, one);
+        const __mmask8 bulb = _mm512_cmp_pd_mask(_mm512_add_pd(_mm512_mul_pd(xb, xb), ci2), _mm512_set1_pd(0.0625), _CMP_LE_OQ);
+        return cardioid | bulb;
+    }
+
+    // 4 points per group. Lanes that escaped stay masked off until every lane
+    // of the group is done, the tail group masks off the missing lanes. The
+    // cycle check and the |z|^2 output are template parameters so they cost
+    // nothing when disabled.
+    template <bool Periodicity, bool Norms>
+    __attribute__((target("avx2,fma")))
+    inline void iterationCountsAvx2(const double* real, const double* imag, int count, int maxIterations, const KernelOptions& options, int* iterations, KernelStats& stats, double* norms) {
+        const __m256d four = _mm256_set1_pd(4.0);
+        const __m256d tolerance = _mm256_set1_pd(options.periodicityTolerance);
+        const __m256d signMask = _mm256_set1_pd(-0.0);
+        const __m256i maxCount = _mm256_set1_epi64x(maxIterations);
+        for (int i = 0; i < count; i += 4) {
+            const int lanes = std::min(4, count - i);
+            const __m256i laneMask = _mm256_cmpgt_epi64(_mm256_set1_epi64x(lanes), _mm256_setr_epi64x(0, 1, 2, 3));
+            const __m256d cr = _mm256_maskload_pd(real + i, laneMask);
+            const __m256d ci = _mm256_maskload_pd(imag + i, laneMask);
+
+            __m256d zr = cr;
+            __m256d zi = ci;
+            __m256d active = _mm256_castsi256_pd(laneMask);
+            __m256i counts = _mm256_setzero_si256();
+            if (options.interiorCheck) {
+                // Interior lanes start finished with the full iteration count
+                const __m256d interior = _mm256_and_pd(active, cardioidOrBulbAvx2(cr, ci));
+                active = _mm256_andnot_pd(interior, active);
+                counts = _mm256_and_si256(_mm256_castpd_si256(interior), maxCount);
+            }
+            __m256d savedR = zr;
+            __m256d savedI = zi;
+            __m256d escapeNorms = _mm256_setzero_pd();
+            std::int64_t checkpoint = 1;
+            for (int n = 0; n < maxIterations; ++n) {
+                __m256d zr2 = _mm256_mul_pd(zr, zr);
+                __m256d zi2 = _mm256_mul_pd(zi, zi);
+                const __m256d norm = _mm256_add_pd(zr2, zi2);
+                const __m256d inside = _mm256_cmp_pd(norm, four, _CMP_LE_OQ);
+                if constexpr (Norms) {
+                    // Lanes escaping in this iteration keep their |z|^2
+                    escapeNorms = _mm256_blendv_pd(escapeNorms, norm, _mm256_andnot_pd(inside, active));
+                }
+                active = _mm256_and_pd(active, inside);
+                if (_mm256_movemask_pd(active) == 0) break;
+                // Active lanes are all ones (-1), so subtracting counts them
+                counts = _mm256_sub_epi64(counts, _mm256_castpd_si256(active));
+                // Multiply and add round separately, like the scalar kernel
+                zi = _mm256_add_pd(_mm256_mul_pd(_mm256_add_pd(zr, zr), zi), ci);
+                zr = _mm256_add_pd(_mm256_sub_pd(zr2, zi2), cr);
+                if constexpr (Periodicity) {
+                    const __m256d closeR = _mm256_cmp_pd(_mm256_andnot_pd(signMask, _mm256_sub_pd(zr, savedR)), tolerance, _CMP_LT_OQ);
+                    const __m256d closeI = _mm256_cmp_pd(_mm256_andnot_pd(signMask, _mm256_sub_pd(zi, savedI)), tolerance, _CMP_LT_OQ);
+                    const __m256d periodic = _mm256_and_pd(active, _mm256_and_pd(closeR, closeI));
+                    const int periodicLanes = _mm256_movemask_pd(periodic);
+                    if (periodicLanes != 0) {
+                        counts = _mm256_blendv_epi8(counts, maxCount, _mm256_castpd_si256(periodic));
+                        active = _mm256_andnot_pd(periodic, active);
+                        const int found = __builtin_popcount(static_cast<unsigned>(periodicLanes));
+                        stats.addPeriodic(found, n + 1, maxIterations);
+                    }
+                    if (n + 1 == checkpoint) {
+                        savedR = zr;
+                        savedI = zi;
+                        checkpoint *= 2;
+                    }
+                }
+            }
+
+            alignas(32) std::int64_t out[4];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(out), counts);
+            for (int l = 0; l < lanes; ++l) iterations[i + l] = static_cast<int>(out[l]);
+            if constexpr (Norms) _mm256_maskstore_pd(norms + i, laneMask, escapeNorms);
+        }
+    }
+
+    // Same scheme as the AVX2 path with 8 points per group and mask registers
+    template <bool Periodicity, bool Norms>
+    __attribute__((target("avx512f")))
+    inline void iterationCountsAvx512(const double* real, const double* imag, int count, int maxIterations, const KernelOptions& options, int* iterations, KernelStats& stats, double* norms) {
+        const __m512d four = _mm512_set1_pd(4.0);
+        const __m512d tolerance = _mm512_set1_pd(options.periodicityTolerance);
+        const __m512i one = _mm512_set1_epi64(1);
+        const __m512i maxCount = _mm512_set1_epi64(maxIterations);
+        for (int i = 0; i < count; i += 8) {
+            const int lanes = std::min(8, count - i);
+            const __mmask8 laneMask = static_cast<__mmask8>((1u << lanes) - 1u);
+            const __m512d cr = _mm512_maskz_loadu_pd(laneMask, real + i);
+            const __m512d ci = _mm512_maskz_loadu_pd(laneMask, imag + i);
+
+            __m512d zr = cr;
+            __m512d zi = ci;
+            __mmask8 active = laneMask;
+            __m512i counts = _mm512_setzero_si512();
+            if (options.interiorCheck) {
+                const __mmask8 interior = active & cardioidOrBulbAvx512(cr, ci);
+                active &= static_cast<__mmask8>(~interior);
+                counts = _mm512_maskz_mov_epi64(interior, maxCount);
+            }
+            __m512d savedR = zr;
+            __m512d savedI = zi;
+            __m512d escapeNorms = _mm512_setzero_pd();
+            std::int64_t checkpoint = 1;
+            for (int n = 0; n < maxIterations; ++n) {
+                __m512d zr2 = _mm512_mul_pd(zr, zr);
+                __m512d zi2 = _mm512_mul_pd(zi, zi);
+                const __m512d norm = _mm512_add_pd(zr2, zi2);
+                const __mmask8 inside = _mm512_cmp_pd_mask(norm, four, _CMP_LE_OQ);
+                if constexpr (Norms) escapeNorms = _mm512_mask_mov_pd(escapeNorms, active & static_cast<__mmask8>(~inside), norm);
+                active &= inside;
+                if (active == 0) break;
+                counts = _mm512_mask_add_epi64(counts, active, counts, one);
+                zi = _mm512_add_pd(_mm512_mul_pd(_mm512_add_pd(zr, zr), zi), ci);
+                zr = _mm512_add_pd(_mm512_sub_pd(zr2, zi2), cr);
+                if constexpr (Periodicity) {
+                    const __mmask8 closeR = _mm512_cmp_pd_mask(_mm512_abs_pd(_mm512_sub_pd(zr, savedR)), tolerance, _CMP_LT_OQ);
+                    const __mmask8 closeI = _mm512_cmp_pd_mask(_mm512_abs_pd(_mm512_sub_pd(zi, savedI)), tolerance, _CMP_LT_OQ);
+                    const __mmask8 periodic = active & closeR & closeI;
+                    if (periodic != 0) {
+                        counts = _mm512_mask_mov_epi64(counts, periodic, maxCount);
+                        active &= static_cast<__mmask8>(~periodic);
+                        const int found = __builtin_popcount(static_cast<unsigned>(periodic));
+                        stats.addPeriodic(found, n + 1, maxIterations);
+                    }
+                    if (n + 1 == checkpoint) {
+                        savedR = zr;
+                        savedI = zi;
+                        checkpoint *= 2;
+                    }
+                }
+            }
+
+            alignas(64) std::int64_t out[8];
+            _mm512_store_si512(out, counts);
+            for (int l = 0; l < lanes; ++l) iterations[i + l] = static_cast<int>(out[l]);
+            if constexpr (Norms) _mm512_mask_storeu_pd(norms + i, laneMask, escapeNorms);
+        }
+    }
+#endif
+
+    inline KernelIsa detectKernelIsa() {
+#if MANDELBROT_KERNEL_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx512f")) return KernelIsa::AVX512;
+        if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma")) return KernelIsa::AVX2;
+#endif
+        return KernelIsa::Scalar;
+    }
+
+    inline KernelIsa& selectedIsa() {
+        static KernelIsa isa = detectKernelIsa();
+        return isa;
+    }
+}
+
+// Best instruction set supported by this CPU, resolved once through CPUID
+inline KernelIsa supportedKernelIsa() {
+    static const KernelIsa isa = mandelbrot_simd::detectKernelIsa();
+    return isa;
+}
+
+inline KernelIsa activeKernelIsa() {
+    return mandelbrot_simd::selectedIsa();
+}
+
+// Force a narrower kernel (e.g. for benchmarking). Requests above what the CPU
+// supports fall back to the best supported one.
+inline void setKernelIsa(KernelIsa isa) {
+    mandelbrot_simd::selectedIsa() = std::min(isa, supportedKernelIsa());
+}
+
+// Iteration counts for `count` points, e.g. one row of the image. Every point
+// goes through the same vector path (tails are masked, not run scalar), so the
+// result for a pixel does not depend on where it sits in the batch. Counters
+// are added to stats when given, |z|^2 at escape is written to norms when
+// given.
+inline void mandelbrotIterationCounts(const double* real, const double* imag, int count, int maxIterations, const KernelOptions& options, int* iterations, KernelStats* stats = nullptr,
+                                      double* norms = nullptr) {
+    // The vector paths are the (double, z^2, radius 2) member of the family,
+    // other exponents and radii go through the generic kernels
+    if (options.power != 2 || options.bailoutRadius != 2) {
+        if (EscapeTimeKernel kernel = escapeTimeKernel(KernelScalar::Double, options.power, options.bailoutRadius)) {
+            kernel(DoubleDouble(), DoubleDouble(), real, imag, count, maxIterations, options, iterations, stats, norms);
+        } else {
+            std::fill(iterations, iterations + count, maxIterations);
+        }
+        return;
+    }
+    KernelStats localStats;
+    const bool periodicity = options.periodicityTolerance > 0.0;
+    switch (activeKernelIsa()) {
+#if MANDELBROT_KERNEL_X86
+        case KernelIsa::AVX512:
+            if (periodicity && norms) mandelbrot_simd::iterationCountsAvx512<true, true>(real, imag, count, maxIterations, options, iterations, localStats, norms);
+            else if (periodicity) mandelbrot_simd::iterationCountsAvx512<true, false>(real, imag, count, maxIterations, options, iterations, localStats, norms);
+            else if (norms) mandelbrot_simd::iterationCountsAvx512<false, true>(real, imag, count, maxIterations, options, iterations, localStats, norms);
+            else mandelbrot_simd::iterationCountsAvx512<false, false>(real, imag, count, maxIterations, options, iterations, localStats, norms);
+            break;
+        case KernelIsa::AVX2:
+            if (periodicity && norms) mandelbrot_simd::iterationCountsAvx2<true, true>(real, imag, count, maxIterations, options, iterations, localStats, norms);
+            else if (periodicity) mandelbrot_simd::iterationCountsAvx2<true, false>(real, imag, count, maxIterations, options, iterations, localStats, norms);
+            else if (norms) mandelbrot_simd::iterationCountsAvx2<false, true>(real, imag, count, maxIterations, options, iterations, localStats, norms);
+            else mandelbrot_simd::iterationCountsAvx2<false, false>(real, imag, count, maxIterations, options, iterations, localStats, norms);
+            break;
+#endif
+        default:
+            mandelbrot_simd::iterationCountsScalar(real, imag, count, maxIterations, options, iterations, &localStats, norms);
+            break;
+    }
+    if (stats) *stats += localStats;
+}
+
+// Fraction bits of the continuous counts below
+constexpr int smoothFractionBits = 8;
+// Largest iteration limit whose continuous counts fit in an int
+constexpr int maxSmoothIterations = std::numeric_limits<int>::max() >> smoothFractionBits;
+
+// log2 of a positive finite double to within 2e-4: the exponent bits plus a
+// polynomial of the mantissa, exact at powers of two. Far more precise than
+// the fraction bits of a continuous count need, and much cheaper than std::log.
+inline double fastLog2(double x) {
+    const auto bits = std::bit_cast<std::uint64_t>(x);
+    const int exponent = static_cast<int>((bits >> 52) & 0x7FF) - 1023;
+    // Mantissa in [1, 2), the polynomial fits log2(1 + t) on [0, 1)
+    const double t = std::bit_cast<double>((bits & 0x000FFFFFFFFFFFFFull) | 0x3FF0000000000000ull) - 1.0;
+    return exponent + t * (1.4380732454005543 + t * (-0.6747666626388481 + t * (0.31700072110008803 + t * -0.0803073038617943)));
+}
+
+// Constants of smoothIterationCount for the exponent and escape radius of
+// options, computed once per frame
+struct SmoothCountScale {
+    // |z|^2 to log_R |z| factor, 0.5 / log2 R
+    double normScale = 0.5;
+    // 1 / log2 d
+    double powerScale = 1.0;
+
+    SmoothCountScale() = default;
+    explicit SmoothCountScale(const KernelOptions& options)
+        : normScale(0.5 / std::log2(static_cast<double>(options.bailoutRadius))), powerScale(1.0 / std::log2(static_cast<double>(options.power))) {}
+};
+
+// Continuous (normalized) iteration count of a point that escaped after
+// `iteration` steps with |z|^2 = norm:
+//     iteration + 1 - log_d(log|z| / log R)
+// in fixed point with smoothFractionBits fraction bits. The fraction is kept
+// in [0, 1), so shifting the fraction off gives the plain count back. Points
+// that did not escape stay at maxIterations, which must not exceed
+// maxSmoothIterations.
+inline int smoothIterationCount(int iteration, double norm, int maxIterations, const SmoothCountScale& scale) {
+    if (iteration >= maxIterations || !(norm > 1.0)) return std::min(iteration, maxIterations) << smoothFractionBits;
+    const double fraction = 1.0 - fastLog2(fastLog2(norm) * scale.normScale) * scale.powerScale;
+    const int one = 1 << smoothFractionBits;
+    const int scaled = static_cast<int>(std::clamp(fraction, 0.0, 1.0) * one);
+    return (iteration << smoothFractionBits) + std::min(scaled, one - 1);
+}
+
+#endif
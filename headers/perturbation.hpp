@@ -0,0 +1,453 @@
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#ifndef PERTURBATION_HPP
+#define PERTURBATION_HPP
+
+// Local
+#include "big_fixed.hpp"
+#include "double_double.hpp"
+#include "mandelbrot_kernel.hpp"
+
+// Iteration count reported for a pixel whose perturbed orbit lost precision
+// against the reference orbit (a glitch). It has to be computed again with a
+// different reference.
+constexpr int glitchedIteration = -2;
+
+// Arithmetic the CPU renderer iterates pixels in, ordered by cost. Once
+// plain double runs out, perturbation comes before double-double: with the
+// series approximation it skips most iterations and runs double deltas per
+// pixel, several times faster than double-double even right past the double
+// limit. Double-double and exact BigFixed iterate the pixels perturbation
+// could not resolve.
+enum class PrecisionTier { Double, Perturbation, DoubleDouble, Exact };
+
+inline const char* precisionTierName(PrecisionTier tier) {
+    switch (tier) {
+        case PrecisionTier::Perturbation: return "perturbation";
+        case PrecisionTier::DoubleDouble: return "double-double";
+        case PrecisionTier::Exact: return "exact";
+        default: return "double";
+    }
+}
+
+// Cheapest tier that resolves the given pixel spacing, leaving perturbation
+// out when it is not allowed (e.g. for its own glitches)
+inline PrecisionTier precisionTierForSpacing(double pixelSpacing, const std::complex<double>& center, int maxIterations, bool allowPerturbation = true) {
+    if (precisionCoversSpacing(doubleRoundoff, pixelSpacing, center, maxIterations)) return PrecisionTier::Double;
+    if (allowPerturbation) return PrecisionTier::Perturbation;
+    if (precisionCoversSpacing(doubleDoubleRoundoff, pixelSpacing, center, maxIterations)) return PrecisionTier::DoubleDouble;
+    return PrecisionTier::Exact;
+}
+
+// Orbit of a single reference point C, computed in BigFixed precision and
+// stored rounded to double. Pixels are iterated as small deltas against it.
+struct ReferenceOrbit {
+    // Z_1 .. Z_n of the reference (Z_1 = C), up to and including the first
+    // point that escapes
+    std::vector<double> zr;
+    std::vector<double> zi;
+    // Pauldelbrot glitch bound per orbit point: a pixel whose full orbit
+    // value |Z + dz|^2 drops below it has lost too many significant bits
+    std::vector<double> glitchBound;
+    // Position of the reference in pixels, deltas are measured from here
+    double pixelX = 0.0;
+    double pixelY = 0.0;
+    // Series approximation: every pixel starts at iteration seriesSkip with
+    // dz = A dc + B dc^2 + C dc^3 instead of iterating from dz = dc
+    int seriesSkip = 0;
+    std::complex<double> seriesA{1.0, 0.0};
+    std::complex<double> seriesB{0.0, 0.0};
+    std::complex<double> seriesC{0.0, 0.0};
+
+    int length() const { return static_cast<int>(zr.size()); }
+};
+
+// Compute the orbit of the reference point c for up to maxIterations steps,
+// in the precision of c, until |Z|^2 exceeds bailoutNorm
+inline ReferenceOrbit computeReferenceOrbit(const BigComplex& c, int maxIterations, double bailoutNorm) {
+    // |Z + dz| < 1e-3 |Z| means about 10 bits of dz were cancelled
+    const double glitchTolerance = 1e-3;
+
+    ReferenceOrbit orbit;
+    orbit.zr.reserve(maxIterations);
+    orbit.zi.reserve(maxIterations);
+    orbit.glitchBound.reserve(maxIterations);
+
+    BigFixed zr = c.real;
+    BigFixed zi = c.imag;
+    for (int i = 0; i < maxIterations; ++i) {
+        const double r = zr.toDouble();
+        const double im = zi.toDouble();
+        const double norm = r * r + im * im;
+        orbit.zr.push_back(r);
+        orbit.zi.push_back(im);
+        orbit.glitchBound.push_back(glitchTolerance * glitchTolerance * norm);
+        if (norm > bailoutNorm) break;
+        // zi = 2 zr zi + ci, zr = zr^2 - zi^2 + cr
+        BigFixed zr2 = zr.square();
+        zr2 -= zi.square();
+        zi = BigFixed::mulAdd(zr.doubled(), zi, c.imag);
+        zr = std::move(zr2);
+        zr += c.real;
+    }
+    return orbit;
+}
+
+// Starting delta of a pixel at iteration orbit.seriesSkip, from the series
+// approximation (dc itself when nothing is skipped)
+inline std::complex<double> seriesDelta(const ReferenceOrbit& orbit, double dcr, double dci) {
+    if (orbit.seriesSkip == 0) return {dcr, dci};
+    const std::complex<double> dc(dcr, dci);
+    return ((orbit.seriesC * dc + orbit.seriesB) * dc + orbit.seriesA) * dc;
+}
+
+// Escape-time count of the pixel at reference + (dcr, dci), iterating only
+// the delta dz of its orbit against the reference:
+//     dz' = 2 Z dz + dz^2 + dc
+// The count matches mandelbrotIterationCount for the same point. Returns
+// glitchedIteration when the delta loses precision or the pixel outlives the
+// reference orbit. escapeNorm, when given, receives |z|^2 at escape.
+// The cycle check of options compares full orbit points as (Z - Z_saved) +
+// (dz - dz_saved), so deltas far below one ulp of Z still count.
+inline int perturbedIterationCount(const ReferenceOrbit& orbit, double dcr, double dci, int maxIterations, const KernelOptions& options = KernelOptions(), KernelStats* stats = nullptr,
+                                   double* escapeNorm = nullptr) {
+    const int steps = std::min(maxIterations, orbit.length());
+    const double* zr = orbit.zr.data();
+    const double* zi = orbit.zi.data();
+    const double* glitchBound = orbit.glitchBound.data();
+    const int skip = std::min(orbit.seriesSkip, steps);
+    const std::complex<double> start = skip > 0 ? seriesDelta(orbit, dcr, dci) : std::complex<double>(dcr, dci);
+    double dzr = start.real();
+    double dzi = start.imag();
+    if (skip > 0 && stats) stats->seriesSkipped += static_cast<std::uint64_t>(skip);
+    const double bailoutNorm = options.bailoutNorm();
+    const double tolerance = options.periodicityTolerance;
+    // Orbit point the cycle check compares against, refreshed at powers of
+    // two iterations past the skip
+    int saved = skip;
+    double savedDzr = dzr;
+    double savedDzi = dzi;
+    int checkpoint = 1;
+    for (int i = skip; i < steps; ++i) {
+        const double fullR = zr[i] + dzr;
+        const double fullI = zi[i] + dzi;
+        const double norm = fullR * fullR + fullI * fullI;
+        if (norm > bailoutNorm) {
+            if (escapeNorm) *escapeNorm = norm;
+            return i;
+        }
+        if (norm < glitchBound[i]) {
+            if (stats) ++stats->glitchedPoints;
+            return glitchedIteration;
+        }
+        if (tolerance > 0.0 && i > skip) {
+            if (std::abs((zr[i] - zr[saved]) + (dzr - savedDzr)) < tolerance && std::abs((zi[i] - zi[saved]) + (dzi - savedDzi)) < tolerance) {
+                // z_i is tested before step i, after i steps
+                if (stats) stats->addPeriodic(1, i, maxIterations);
+                return maxIterations;
+            }
+            if (i - skip == checkpoint) {
+                saved = i;
+                savedDzr = dzr;
+                savedDzi = dzi;
+                checkpoint *= 2;
+            }
+        }
+        // dz' = (2 Z + dz) dz + dc
+        const double tr = 2.0 * zr[i] + dzr;
+        const double ti = 2.0 * zi[i] + dzi;
+        const double nextR = tr * dzr - ti * dzi + dcr;
+        dzi = tr * dzi + ti * dzr + dci;
+        dzr = nextR;
+    }
+    if (steps == maxIterations) return maxIterations;
+    // The reference escaped first, its orbit cannot carry this pixel further
+    if (stats) ++stats->glitchedPoints;
+    return glitchedIteration;
+}
+
+// Series approximation stage. The deltas of all pixels follow the reference
+// closely for many iterations, where dz_n is well approximated by the cubic
+//     A_n dc + B_n dc^2 + C_n dc^3,
+//     A_n+1 = 2 Z_n A_n + 1, B_n+1 = 2 Z_n B_n + A_n^2, C_n+1 = 2 Z_n C_n + 2 A_n B_n
+// The number of iterations to skip is chosen by iterating probe deltas (the
+// frame border, where the approximation error of the polynomial is largest)
+// exactly and stopping at the first iteration where the series misses one of
+// them by more than the relative tolerance, or one of them escapes (|z|^2 above
+// bailoutNorm) or glitches.
+inline void computeSeriesApproximation(ReferenceOrbit& orbit, const std::vector<std::complex<double>>& probes, int maxIterations, double bailoutNorm) {
+    const double tolerance = 1e-11;
+
+    const int steps = std::min(maxIterations, orbit.length());
+    std::vector<std::complex<double>> dz(probes);
+    std::complex<double> a(1.0, 0.0), b(0.0, 0.0), c(0.0, 0.0);
+    orbit.seriesSkip = 0;
+    orbit.seriesA = a;
+    orbit.seriesB = b;
+    orbit.seriesC = c;
+    for (int i = 0; i < steps; ++i) {
+        const std::complex<double> z(orbit.zr[i], orbit.zi[i]);
+        for (size_t p = 0; p < probes.size(); ++p) {
+            const std::complex<double> series = ((c * probes[p] + b) * probes[p] + a) * probes[p];
+            const double norm = std::norm(z + dz[p]);
+            if (std::abs(series - dz[p]) > tolerance * std::abs(dz[p]) || norm > bailoutNorm || norm < orbit.glitchBound[i]) return;
+        }
+        // The series is valid at iteration i for every probe
+        orbit.seriesSkip = i;
+        orbit.seriesA = a;
+        orbit.seriesB = b;
+        orbit.seriesC = c;
+
+        const std::complex<double> twoZ = 2.0 * z;
+        c = twoZ * c + 2.0 * a * b;
+        b = twoZ * b + a * a;
+        a = twoZ * a + 1.0;
+        for (size_t p = 0; p < probes.size(); ++p) {
+            dz[p] = (twoZ + dz[p]) * dz[p] + probes[p];
+        }
+    }
+}
+
+namespace perturbation_simd {
+
+#if MANDELBROT_KERNEL_X86
+    // perturbedIterationCount on 4 pixels per group, in the same operations
+    // and order, so every lane matches the scalar count. All lanes of a group
+    // start at the series skip and read the same reference point per
+    // iteration; lanes that escape, glitch or close a cycle are masked off
+    // and the group stops once none is left.
+    template <bool Periodicity, bool Norms>
+    __attribute__((target("avx2,fma")))
+    inline void perturbedCountsAvx2(const ReferenceOrbit& orbit, const double* dcr, const double* dci, int count, int maxIterations, const KernelOptions& options, int* iterations,
+                                    KernelStats& stats, double* norms) {
+        const int steps = std::min(maxIterations, orbit.length());
+        const int skip = std::min(orbit.seriesSkip, steps);
+        const double* zr = orbit.zr.data();
+        const double* zi = orbit.zi.data();
+        const double* glitchBound = orbit.glitchBound.data();
+        const __m256d bailout = _mm256_set1_pd(options.bailoutNorm());
+        const __m256d tolerance = _mm256_set1_pd(options.periodicityTolerance);
+        const __m256d signMask = _mm256_set1_pd(-0.0);
+        const __m256i maxCount = _mm256_set1_epi64x(maxIterations);
+        const __m256i glitchCount = _mm256_set1_epi64x(glitchedIteration);
+        for (int i = 0; i < count; i += 4) {
+            const int lanes = std::min(4, count - i);
+            const __m256i laneMask = _mm256_cmpgt_epi64(_mm256_set1_epi64x(lanes), _mm256_setr_epi64x(0, 1, 2, 3));
+            const __m256d cr = _mm256_maskload_pd(dcr + i, laneMask);
+            const __m256d ci = _mm256_maskload_pd(dci + i, laneMask);
+            __m256d dzr = cr;
+            __m256d dzi = ci;
+            if (skip > 0) {
+                alignas(32) double startR[4] = {};
+                alignas(32) double startI[4] = {};
+                for (int l = 0; l < lanes; ++l) {
+                    const std::complex<double> start = seriesDelta(orbit, dcr[i + l], dci[i + l]);
+                    startR[l] = start.real();
+                    startI[l] = start.imag();
+                }
+                dzr = _mm256_load_pd(startR);
+                dzi = _mm256_load_pd(startI);
+                stats.seriesSkipped += static_cast<std::uint64_t>(skip) * lanes;
+            }
+
+            __m256d active = _mm256_castsi256_pd(laneMask);
+            __m256i counts = maxCount;
+            __m256d escapeNorms = _mm256_setzero_pd();
+            int saved = skip;
+            __m256d savedDzr = dzr;
+            __m256d savedDzi = dzi;
+            int checkpoint = 1;
+            for (int n = skip; n < steps; ++n) {
+                const __m256d refR = _mm256_set1_pd(zr[n]);
+                const __m256d refI = _mm256_set1_pd(zi[n]);
+                const __m256d fullR = _mm256_add_pd(refR, dzr);
+                const __m256d fullI = _mm256_add_pd(refI, dzi);
+                const __m256d norm = _mm256_add_pd(_mm256_mul_pd(fullR, fullR), _mm256_mul_pd(fullI, fullI));
+                const __m256d escaped = _mm256_and_pd(active, _mm256_cmp_pd(norm, bailout, _CMP_GT_OQ));
+                const __m256d glitched = _mm256_andnot_pd(escaped, _mm256_and_pd(active, _mm256_cmp_pd(norm, _mm256_set1_pd(glitchBound[n]), _CMP_LT_OQ)));
+                const __m256d finished = _mm256_or_pd(escaped, glitched);
+                if (_mm256_movemask_pd(finished) != 0) {
+                    counts = _mm256_blendv_epi8(counts, _mm256_set1_epi64x(n), _mm256_castpd_si256(escaped));
+                    counts = _mm256_blendv_epi8(counts, glitchCount, _mm256_castpd_si256(glitched));
+                    if constexpr (Norms) escapeNorms = _mm256_blendv_pd(escapeNorms, norm, escaped);
+                    stats.glitchedPoints += static_cast<std::uint64_t>(__builtin_popcount(static_cast<unsigned>(_mm256_movemask_pd(glitched))));
+                    active = _mm256_andnot_pd(finished, active);
+                }
+                if constexpr (Periodicity) {
+                    if (n > skip) {
+                        const __m256d diffR = _mm256_add_pd(_mm256_set1_pd(zr[n] - zr[saved]), _mm256_sub_pd(dzr, savedDzr));
+                        const __m256d diffI = _mm256_add_pd(_mm256_set1_pd(zi[n] - zi[saved]), _mm256_sub_pd(dzi, savedDzi));
+                        const __m256d closeR = _mm256_cmp_pd(_mm256_andnot_pd(signMask, diffR), tolerance, _CMP_LT_OQ);
+                        const __m256d closeI = _mm256_cmp_pd(_mm256_andnot_pd(signMask, diffI), tolerance, _CMP_LT_OQ);
+                        const __m256d periodic = _mm256_and_pd(active, _mm256_and_pd(closeR, closeI));
+                        const int periodicLanes = _mm256_movemask_pd(periodic);
+                        if (periodicLanes != 0) {
+                            counts = _mm256_blendv_epi8(counts, maxCount, _mm256_castpd_si256(periodic));
+                            active = _mm256_andnot_pd(periodic, active);
+                            const int found = __builtin_popcount(static_cast<unsigned>(periodicLanes));
+                            stats.addPeriodic(found, n, maxIterations);
+                        }
+                        if (n - skip == checkpoint) {
+                            saved = n;
+                            savedDzr = dzr;
+                            savedDzi = dzi;
+                            checkpoint *= 2;
+                        }
+                    }
+                }
+                if (_mm256_movemask_pd(active) == 0) break;
+                // dz' = (2 Z + dz) dz + dc
+                const __m256d tr = _mm256_add_pd(_mm256_add_pd(refR, refR), dzr);
+                const __m256d ti = _mm256_add_pd(_mm256_add_pd(refI, refI), dzi);
+                const __m256d nextR = _mm256_add_pd(_mm256_sub_pd(_mm256_mul_pd(tr, dzr), _mm256_mul_pd(ti, dzi)), cr);
+                dzi = _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(tr, dzi), _mm256_mul_pd(ti, dzr)), ci);
+                dzr = nextR;
+            }
+            // Lanes still running outlived a reference that escaped first
+            const int outlived = _mm256_movemask_pd(active);
+            if (steps < maxIterations && outlived != 0) {
+                counts = _mm256_blendv_epi8(counts, glitchCount, _mm256_castpd_si256(active));
+                stats.glitchedPoints += static_cast<std::uint64_t>(__builtin_popcount(static_cast<unsigned>(outlived)));
+            }
+
+            alignas(32) std::int64_t out[4];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(out), counts);
+            for (int l = 0; l < lanes; ++l) iterations[i + l] = static_cast<int>(out[l]);
+            if constexpr (Norms) _mm256_maskstore_pd(norms + i, laneMask, escapeNorms);
+        }
+    }
+
+    // Same scheme as the AVX2 path with 8 pixels per group and mask registers
+    template <bool Periodicity, bool Norms>
+    __attribute__((target("avx512f")))
+    inline void perturbedCountsAvx512(const ReferenceOrbit& orbit, const double* dcr, const double* dci, int count, int maxIterations, const KernelOptions& options, int* iterations,
+                                      KernelStats& stats, double* norms) {
+        const int steps = std::min(maxIterations, orbit.length());
+        const int skip = std::min(orbit.seriesSkip, steps);
+        const double* zr = orbit.zr.data();
+        const double* zi = orbit.zi.data();
+        const double* glitchBound = orbit.glitchBound.data();
+        const __m512d bailout = _mm512_set1_pd(options.bailoutNorm());
+        const __m512d tolerance = _mm512_set1_pd(options.periodicityTolerance);
+        const __m512i maxCount = _mm512_set1_epi64(maxIterations);
+        const __m512i glitchCount = _mm512_set1_epi64(glitchedIteration);
+        for (int i = 0; i < count; i += 8) {
+            const int lanes = std::min(8, count - i);
+            const __mmask8 laneMask = static_cast<__mmask8>((1u << lanes) - 1u);
+            const __m512d cr = _mm512_maskz_loadu_pd(laneMask, dcr + i);
+            const __m512d ci = _mm512_maskz_loadu_pd(laneMask, dci + i);
+            __m512d dzr = cr;
+            __m512d dzi = ci;
+            if (skip > 0) {
+                alignas(64) double startR[8] = {};
+                alignas(64) double startI[8] = {};
+                for (int l = 0; l < lanes; ++l) {
+                    const std::complex<double> start = seriesDelta(orbit, dcr[i + l], dci[i + l]);
+                    startR[l] = start.real();
+                    startI[l] = start.imag();
+                }
+                dzr = _mm512_load_pd(startR);
+                dzi = _mm512_load_pd(startI);
+                stats.seriesSkipped += static_cast<std::uint64_t>(skip) * lanes;
+            }
+
+            __mmask8 active = laneMask;
+            __m512i counts = maxCount;
+            __m512d escapeNorms = _mm512_setzero_pd();
+            int saved = skip;
+            __m512d savedDzr = dzr;
+            __m512d savedDzi = dzi;
+            int checkpoint = 1;
+            for (int n = skip; n < steps; ++n) {
+                const __m512d refR = _mm512_set1_pd(zr[n]);
+                const __m512d refI = _mm512_set1_pd(zi[n]);
+                const __m512d fullR = _mm512_add_pd(refR, dzr);
+                const __m512d fullI = _mm512_add_pd(refI, dzi);
+                const __m512d norm = _mm512_add_pd(_mm512_mul_pd(fullR, fullR), _mm512_mul_pd(fullI, fullI));
+                const __mmask8 escaped = active & _mm512_cmp_pd_mask(norm, bailout, _CMP_GT_OQ);
+                const __mmask8 glitched = active & static_cast<__mmask8>(~escaped) & _mm512_cmp_pd_mask(norm, _mm512_set1_pd(glitchBound[n]), _CMP_LT_OQ);
+                if ((escaped | glitched) != 0) {
+                    counts = _mm512_mask_mov_epi64(counts, escaped, _mm512_set1_epi64(n));
+                    counts = _mm512_mask_mov_epi64(counts, glitched, glitchCount);
+                    if constexpr (Norms) escapeNorms = _mm512_mask_mov_pd(escapeNorms, escaped, norm);
+                    stats.glitchedPoints += static_cast<std::uint64_t>(__builtin_popcount(static_cast<unsigned>(glitched)));
+                    active &= static_cast<__mmask8>(~(escaped | glitched));
+                }
+                if constexpr (Periodicity) {
+                    if (n > skip) {
+                        const __m512d diffR = _mm512_add_pd(_mm512_set1_pd(zr[n] - zr[saved]), _mm512_sub_pd(dzr, savedDzr));
+                        const __m512d diffI = _mm512_add_pd(_mm512_set1_pd(zi[n] - zi[saved]), _mm512_sub_pd(dzi, savedDzi));
+                        const __mmask8 closeR = _mm512_cmp_pd_mask(_mm512_abs_pd(diffR), tolerance, _CMP_LT_OQ);
+                        const __mmask8 closeI = _mm512_cmp_pd_mask(_mm512_abs_pd(diffI), tolerance, _CMP_LT_OQ);
+                        const __mmask8 periodic = active & closeR & closeI;
+                        if (periodic != 0) {
+                            counts = _mm512_mask_mov_epi64(counts, periodic, maxCount);
+                            active &= static_cast<__mmask8>(~periodic);
+                            const int found = __builtin_popcount(static_cast<unsigned>(periodic));
+                            stats.addPeriodic(found, n, maxIterations);
+                        }
+                        if (n - skip == checkpoint) {
+                            saved = n;
+                            savedDzr = dzr;
+                            savedDzi = dzi;
+                            checkpoint *= 2;
+                        }
+                    }
+                }
+                if (active == 0) break;
+                const __m512d tr = _mm512_add_pd(_mm512_add_pd(refR, refR), dzr);
+                const __m512d ti = _mm512_add_pd(_mm512_add_pd(refI, refI), dzi);
+                const __m512d nextR = _mm512_add_pd(_mm512_sub_pd(_mm512_mul_pd(tr, dzr), _mm512_mul_pd(ti, dzi)), cr);
+                dzi = _mm512_add_pd(_mm512_add_pd(_mm512_mul_pd(tr, dzi), _mm512_mul_pd(ti, dzr)), ci);
+                dzr = nextR;
+            }
+            if (steps < maxIterations && active != 0) {
+                counts = _mm512_mask_mov_epi64(counts, active, glitchCount);
+                stats.glitchedPoints += static_cast<std::uint64_t>(__builtin_popcount(static_cast<unsigned>(active)));
+            }
+
+            alignas(64) std::int64_t out[8];
+            _mm512_store_si512(out, counts);
+            for (int l = 0; l < lanes; ++l) iterations[i + l] = static_cast<int>(out[l]);
+            if constexpr (Norms) _mm512_mask_storeu_pd(norms + i, laneMask, escapeNorms);
+        }
+    }
+#endif
+}
+
+// Batched form for `count` pixels given as deltas from the reference, through
+// the vector path of the active instruction set like mandelbrotIterationCounts
+inline void perturbedIterationCounts(const ReferenceOrbit& orbit, const double* dcr, const double* dci, int count, int maxIterations, const KernelOptions& options, int* iterations,
+                                     KernelStats* stats = nullptr, double* norms = nullptr) {
+    KernelStats localStats;
+    const bool periodicity = options.periodicityTolerance > 0.0;
+    switch (activeKernelIsa()) {
+#if MANDELBROT_KERNEL_X86
+        case KernelIsa::AVX512:
+            if (periodicity && norms) perturbation_simd::perturbedCountsAvx512<true, true>(orbit, dcr, dci, count, maxIterations, options, iterations, localStats, norms);
+            else if (periodicity) perturbation_simd::perturbedCountsAvx512<true, false>(orbit, dcr, dci, count, maxIterations, options, iterations, localStats, norms);
+            else if (norms) perturbation_simd::perturbedCountsAvx512<false, true>(orbit, dcr, dci, count, maxIterations, options, iterations, localStats, norms);
+            else perturbation_simd::perturbedCountsAvx512<false, false>(orbit, dcr, dci, count, maxIterations, options, iterations, localStats, norms);
+            break;
+        case KernelIsa::AVX2:
+            if (periodicity && norms) perturbation_simd::perturbedCountsAvx2<true, true>(orbit, dcr, dci, count, maxIterations, options, iterations, localStats, norms);
+            else if (periodicity) perturbation_simd::perturbedCountsAvx2<true, false>(orbit, dcr, dci, count, maxIterations, options, iterations, localStats, norms);
+            else if (norms) perturbation_simd::perturbedCountsAvx2<false, true>(orbit, dcr, dci, count, maxIterations, options, iterations, localStats, norms);
+            else perturbation_simd::perturbedCountsAvx2<false, false>(orbit, dcr, dci, count, maxIterations, options, iterations, localStats, norms);
+            break;
+#endif
+        default:
+            for (int i = 0; i < count; ++i) {
+                iterations[i] = perturbedIterationCount(orbit, dcr[i], dci[i], maxIterations, options, &localStats, norms ? norms + i : nullptr);
+            }
+            break;
+    }
+    if (stats) *stats += localStats;
+}
+
+#endif
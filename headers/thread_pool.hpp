@@ -0,0 +1,148 @@
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+// Rectangle of pixels [x0, x1) x [y0, y1)
+struct Tile {
+    int x0, y0, x1, y1;
+};
+
+// Persistent pool of render workers. Every frame is cut into small tiles that
+// are dealt out to per-worker deques; a worker that runs out of tiles steals
+// from the back of the other deques, so slow (interior) regions get shared.
+class TileThreadPool {
+public:
+    using TileJob = std::function<void(const Tile& tile, unsigned workerIndex)>;
+
+    explicit TileThreadPool(unsigned threadCount = std::thread::hardware_concurrency()) {
+        threadCount = std::max(1u, threadCount);
+        for (unsigned i = 0; i < threadCount; ++i) {
+            queues.push_back(std::make_unique<WorkerQueue>());
+        }
+        for (unsigned i = 0; i < threadCount; ++i) {
+            workers.emplace_back(&TileThreadPool::workerLoop, this, i);
+        }
+    }
+
+    ~TileThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (auto& worker : workers) {
+            worker.join();
+        }
+    }
+
+    TileThreadPool(const TileThreadPool&) = delete;
+    TileThreadPool& operator=(const TileThreadPool&) = delete;
+
+    unsigned size() const { return static_cast<unsigned>(workers.size()); }
+
+    // Run job on every tileSize x tileSize tile of a width x height frame and
+    // block until all tiles are done
+    void run(int width, int height, int tileSize, const TileJob& tileJob) {
+        const int tilesX = (width + tileSize - 1) / tileSize;
+        const int tilesY = (height + tileSize - 1) / tileSize;
+        const int tileCount = tilesX * tilesY;
+        if (tileCount == 0) return;
+
+        std::unique_lock<std::mutex> lock(mutex);
+        job = &tileJob;
+        pendingTiles.store(tileCount);
+
+        // Deal contiguous runs of tiles to each worker, keeping neighbouring
+        // tiles on the same core as long as nobody needs to steal them
+        const unsigned workerCount = size();
+        for (unsigned w = 0; w < workerCount; ++w) {
+            const int first = static_cast<int>(static_cast<long long>(tileCount) * w / workerCount);
+            const int last = static_cast<int>(static_cast<long long>(tileCount) * (w + 1) / workerCount);
+            std::lock_guard<std::mutex> queueLock(queues[w]->mutex);
+            for (int t = first; t < last; ++t) {
+                const int x0 = (t % tilesX) * tileSize;
+                const int y0 = (t / tilesX) * tileSize;
+                queues[w]->tiles.push_back({x0, y0, std::min(x0 + tileSize, width), std::min(y0 + tileSize, height)});
+            }
+        }
+
+        ++generation;
+        wake.notify_all();
+        done.wait(lock, [this] { return pendingTiles.load() == 0; });
+        job = nullptr;
+    }
+
+private:
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<Tile> tiles;
+    };
+
+    bool popLocal(unsigned workerIndex, Tile& tile) {
+        WorkerQueue& queue = *queues[workerIndex];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tiles.empty()) return false;
+        tile = queue.tiles.front();
+        queue.tiles.pop_front();
+        return true;
+    }
+
+    bool steal(unsigned workerIndex, Tile& tile) {
+        const unsigned workerCount = size();
+        for (unsigned offset = 1; offset < workerCount; ++offset) {
+            WorkerQueue& victim = *queues[(workerIndex + offset) % workerCount];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tiles.empty()) {
+                tile = victim.tiles.back();
+                victim.tiles.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void workerLoop(unsigned workerIndex) {
+        std::uint64_t seenGeneration = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return stopping || generation != seenGeneration; });
+                if (stopping) return;
+                seenGeneration = generation;
+            }
+
+            // The job pointer is published before the tiles, and every tile is
+            // taken under its queue mutex, so it is visible here
+            Tile tile;
+            while (popLocal(workerIndex, tile) || steal(workerIndex, tile)) {
+                (*job)(tile, workerIndex);
+                if (pendingTiles.fetch_sub(1) == 1) {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    done.notify_all();
+                }
+            }
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+    const TileJob* job = nullptr;
+    std::uint64_t generation = 0;
+    std::atomic<int> pendingTiles{0};
+    bool stopping = false;
+};
+
+#endif
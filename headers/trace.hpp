@@ -0,0 +1,15 @@
+#include <iostream>
+
+#ifndef TRACE_HPP
+#define TRACE_HPP
+
+// Debug trace channel, compiled in only with -DMANDELBROT_TRACE (the
+// MANDELBROT_TRACE CMake option). Release builds do no I/O on the input and
+// render paths. Usage: MANDELBROT_TRACE_LOG("zoom " << scale);
+#ifdef MANDELBROT_TRACE
+#define MANDELBROT_TRACE_LOG(message) (std::clog << message << '\n')
+#else
+#define MANDELBROT_TRACE_LOG(message) ((void)0)
+#endif
+
+#endif
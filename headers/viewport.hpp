@@ -0,0 +1,117 @@
+#include <cmath>
+#include <complex>
+#include <utility>
+
+#ifndef VIEWPORT_HPP
+#define VIEWPORT_HPP
+
+// Local
+#include "big_fixed.hpp"
+
+// Visible part of the complex plane: a (rotated) rectangle around center.
+// Pixel coordinates are derived from it on demand, nothing per pixel is stored.
+struct Viewport {
+    std::complex<double> center;
+    // Extent along the imaginary axis
+    double span = 2.0;
+    // Real extent / imaginary extent
+    double aspect = 1.0;
+    // Counter-clockwise rotation in radians
+    double rotation = 0.0;
+    // center is the double closest to the exact view center, these hold the
+    // rest (exact = center + residual). Panning at deep zooms moves the view by
+    // less than one ulp of center, which would otherwise be lost.
+    BigFixed residualReal{};
+    BigFixed residualImag{};
+
+    double realSpan() const { return span * aspect; }
+    double imagSpan() const { return span; }
+
+    // Offset from the center of a point given in normalized view coordinates,
+    // u and v in [0, 1] from the lower left to the upper right corner
+    std::complex<double> offset(double u, double v) const {
+        const double dx = (u - 0.5) * realSpan();
+        const double dy = (v - 0.5) * imagSpan();
+        const double c = std::cos(rotation);
+        const double s = std::sin(rotation);
+        return {dx * c - dy * s, dx * s + dy * c};
+    }
+
+    // Complex coordinate of a point given in normalized view coordinates
+    std::complex<double> toComplex(double u, double v) const {
+        return center + offset(u, v);
+    }
+
+    // Distance between neighbouring pixel centers along the imaginary axis
+    double pixelSpacing(int height) const { return span / height; }
+
+    // Exact view center with the given precision
+    BigComplex exactCenter(int fractionLimbs) const {
+        return {BigFixed::fromDouble(center.real(), fractionLimbs) + residualReal.withFractionLimbs(fractionLimbs),
+                BigFixed::fromDouble(center.imag(), fractionLimbs) + residualImag.withFractionLimbs(fractionLimbs)};
+    }
+
+    // Move the view center to an exact point, e.g. one parsed from text
+    void setExactCenter(const BigComplex& exact) {
+        const int fractionLimbs = exact.real.fractionLimbs();
+        center = {exact.real.toDouble(), exact.imag.toDouble()};
+        residualReal = exact.real - BigFixed::fromDouble(center.real(), fractionLimbs);
+        residualImag = exact.imag - BigFixed::fromDouble(center.imag(), fractionLimbs);
+    }
+
+    // toComplex without rounding to double
+    BigComplex toBigComplex(double u, double v, int fractionLimbs) const {
+        const std::complex<double> delta = offset(u, v);
+        BigComplex result = exactCenter(fractionLimbs);
+        result.real += BigFixed::fromDouble(delta.real(), fractionLimbs);
+        result.imag += BigFixed::fromDouble(delta.imag(), fractionLimbs);
+        return result;
+    }
+
+    // Move the view along its own (possibly rotated) axes. The exact center
+    // is kept in BigFixed, sized for the current span.
+    void pan(double realDelta, double imagDelta) {
+        const double c = std::cos(rotation);
+        const double s = std::sin(rotation);
+        const int fractionLimbs = std::max(fractionLimbsForSpacing(span), residualReal.fractionLimbs());
+        BigComplex exact = exactCenter(fractionLimbs);
+        exact.real += BigFixed::fromDouble(realDelta * c - imagDelta * s, fractionLimbs);
+        exact.imag += BigFixed::fromDouble(realDelta * s + imagDelta * c, fractionLimbs);
+        setExactCenter(exact);
+    }
+
+    // Zoom around the view center, factor < 1 zooms in
+    void scale(double factor) { span *= factor; }
+};
+
+// Net view change of all input events handled in one frame. Events only
+// accumulate into it, the view is updated once when the queue is drained.
+struct ViewChange {
+    // Pan in fractions of the visible span
+    double panReal = 0.0;
+    double panImag = 0.0;
+    double scale = 1.0;
+
+    bool empty() const { return panReal == 0.0 && panImag == 0.0 && scale == 1.0; }
+
+    // Round the pan to whole pixels of a width x height frame of view (which
+    // is not rotated) and return the shift in pixels: pixel (x, y) after the
+    // pan is pixel (x + shiftX, y + shiftY) before it
+    std::pair<int, int> snapToPixels(const Viewport& view, int width, int height) {
+        // Pixels per fraction of the span along each axis
+        const double pixelsReal = width / view.aspect;
+        const double pixelsImag = height;
+        const int shiftX = static_cast<int>(std::lround(panReal * pixelsReal));
+        const int shiftY = static_cast<int>(std::lround(panImag * pixelsImag));
+        panReal = shiftX / pixelsReal;
+        panImag = shiftY / pixelsImag;
+        return {shiftX, shiftY};
+    }
+
+    void applyTo(Viewport& view) const {
+        view.pan(panReal * view.span, panImag * view.span);
+        view.scale(scale);
+    }
+};
+
+#endif
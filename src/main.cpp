@@ -1,82 +1,133 @@
 #include <SFML/Graphics.hpp>
-#include <complex>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <iterator>
 #include <mutex>
-#include <vector>
+#include <string>
 #include <thread>
+#include <utility>
+#include <vector>
 
-
-// Global mutext for image manipulation
-std::mutex imageMutex;
-
-// Function to calculate the Mandelbrot iteration count for a given point
-int mandelbrotIterationCount(const std::complex<double>& z0, int maxIterations) {
-    std::complex<double> z = z0;
-    for(int i = 0; i < maxIterations; ++i) {
-        if(std::abs(z) > 2.0) return i;
-        z = z*z + z0;
-    }
-    return maxIterations;
-}
-
-// Function to map a value from one range to another
-double map(double value, double inMin, double inMax, double outMin, double outMax) {
-    return (value - inMin) * (outMax - outMin) / (inMax - inMin) + outMin;
-}
-
-// Generate a color map based on the number of iterations
-sf::Color getColor(int iteration, int maxIterations) {
-    int r, g, b;
-    double t = (double)iteration / (double)maxIterations;
-
-    // Example gradient: from blue to red
-    r = (int)(9*(1-t)*t*t*t*255);
-    g = (int)(15*(1-t)*t*t*t*255);
-    b = (int)(8.5*(1-t)*t*t*t*255);
-
-    return sf::Color(r, g, b);
-}
+// Local
+#include "../headers/mandelbrot_core.hpp"
 
 // Event manager for user input control
 class MandelbrotEventManager {
 public:
-    MandelbrotEventManager(double initialZoom, const std::complex<double>& initialCenter)
-        : zoom(initialZoom), center(initialCenter) {}
+    // width x height is the frame size, pans are rounded to its pixels
+    MandelbrotEventManager(const Viewport& initialView, int width, int height)
+        : view(initialView), width(width), height(height) {}
 
-    // Process events, adjust zoom and center based on input
-    void handleEvents(sf::RenderWindow& window) {
+    // Process all queued events and apply their net view change once. With
+    // waitForEvent set, blocks until at least one event arrives.
+    // Returns true when the image has to be rendered again.
+    bool handleEvents(sf::RenderWindow& window, bool waitForEvent = false) {
+        ViewChange change;
+        const RenderMode previousMode = renderMode;
+        const int previousPower = power;
+        const bool previousProgressive = progressive;
         sf::Event event;
-        while (window.pollEvent(event)) {
+        bool hasEvent = waitForEvent ? window.waitEvent(event) : window.pollEvent(event);
+        while (hasEvent) {
             if (event.type == sf::Event::Closed)
                 window.close();
             else
-                handleZoomAndPan(event);
+                handleZoomAndPan(event, change);
+            hasEvent = window.pollEvent(event);
         }
+        const bool settingsChanged = renderMode != previousMode || power != previousPower || progressive != previousProgressive;
+        // Whole-pixel pans let the renderer shift the last frame
+        const auto [shiftX, shiftY] = change.snapToPixels(view, width, height);
+        panOnly = !settingsChanged && change.scale == 1.0;
+        pixelShiftX = shiftX;
+        pixelShiftY = shiftY;
+        change.applyTo(view);
+        return !change.empty() || settingsChanged;
     }
 
-    double getZoom() const { return zoom; }
-    std::complex<double> getCenter() const { return center; }
+    const Viewport& getViewport() const { return view; }
+    RenderMode getRenderMode() const { return renderMode; }
+    int getPower() const { return power; }
+    bool isProgressive() const { return progressive; }
+    Palette getPalette() const { return palette; }
+    Coloring getColoring() const { return coloring; }
+    bool isCycling() const { return cycling; }
+
+    // Whether the last handleEvents call only panned the view, and by how
+    // many pixels: pixel (x, y) of the new frame is (x + shiftX, y + shiftY)
+    // of the old one
+    bool onlyPanned(int& shiftX, int& shiftY) const {
+        shiftX = pixelShiftX;
+        shiftY = pixelShiftY;
+        return panOnly;
+    }
 
 private:
-    double zoom;
-    std::complex<double> center;
+    Viewport view;
+    int width;
+    int height;
+    bool panOnly = false;
+    int pixelShiftX = 0;
+    int pixelShiftY = 0;
+    RenderMode renderMode = RenderMode::BruteForce;
+    // Exponent d of z -> z^d + c, one of kernelPowers
+    int power = 2;
+    // Coarse passes first, so pan and zoom show up before the full frame is done
+    bool progressive = true;
+    // Colors only, changing them never renders again
+    Palette palette = Palette::Gradient;
+    Coloring coloring = Coloring::Smooth;
+    bool cycling = false;
 
-    void handleZoomAndPan(const sf::Event& event) {
+    void handleZoomAndPan(const sf::Event& event, ViewChange& change) {
         if (event.type == sf::Event::MouseWheelScrolled) {
-            zoom *= (event.mouseWheelScroll.delta > 0) ? 0.9 : 1.1; // Adjust zoom factor
+            change.scale *= (event.mouseWheelScroll.delta > 0) ? 0.9 : 1.1; // Adjust zoom factor
         } else if (event.type == sf::Event::KeyPressed) {
-            double panSpeed = 0.1 * zoom; // Adjust pan speed based on zoom level
+            const double panStep = 0.05; // Fraction of the visible span
             switch (event.key.code) {
                 case sf::Keyboard::Left:
-                    center.real(center.real() - panSpeed);
+                    change.panReal -= panStep;
                     break;
                 case sf::Keyboard::Right:
-                    center.real(center.real() + panSpeed);
+                    change.panReal += panStep;
                     break;
                 case sf::Keyboard::Up:
-                    center.imag(center.imag() - panSpeed);
+                    change.panImag -= panStep;
                     break;
                 case sf::Keyboard::Down:
-                    center.imag(center.imag() + panSpeed);
+                    change.panImag += panStep;
+                    break;
+                case sf::Keyboard::M:
+                    // Switch between brute force and subdivision rendering
+                    renderMode = (renderMode == RenderMode::BruteForce) ? RenderMode::Subdivision : RenderMode::BruteForce;
+                    break;
+                case sf::Keyboard::D: {
+                    // Next Multibrot exponent
+                    const int count = static_cast<int>(std::size(kernelPowers));
+                    const int index = static_cast<int>(std::find(kernelPowers, kernelPowers + count, power) - kernelPowers);
+                    power = kernelPowers[(index + 1) % count];
+                    break;
+                }
+                case sf::Keyboard::P:
+                    // Toggle progressive rendering
+                    progressive = !progressive;
+                    break;
+                case sf::Keyboard::K:
+                    // Next palette
+                    palette = palette == Palette::Gradient    ? Palette::Grayscale
+                              : palette == Palette::Grayscale ? Palette::Smooth
+                              : palette == Palette::Smooth    ? Palette::Random
+                                                              : Palette::Gradient;
+                    break;
+                case sf::Keyboard::S:
+                    // Next coloring: smooth, histogram equalized, banded
+                    coloring = coloring == Coloring::Smooth ? Coloring::Histogram : coloring == Coloring::Histogram ? Coloring::Banded : Coloring::Smooth;
+                    break;
+                case sf::Keyboard::C:
+                    // Toggle color cycling
+                    cycling = !cycling;
                     break;
                 default:
                     break; // No action for other keys
@@ -85,72 +136,362 @@ private:
     }
 };
 
-// Divide the image in sections
-void renderSection(sf::Image& image, int startX, int endX, int startY, int endY, double zoom, std::complex<double> center, int maxIterations, int width, int height) {
-    for (int x = startX; x < endX; ++x) {
-        for (int y = startY; y < endY; ++y) {
-            std::complex<double> point(map(x, 0, width, center.real() - zoom, center.real() + zoom),
-                                       map(y, 0, height, center.imag() - zoom, center.imag() + zoom));
-            int iteration = mandelbrotIterationCount(point, maxIterations);
-            sf::Color color = getColor(iteration, maxIterations);
-            imageMutex.lock();
-            image.setPixel(x, y, color);
-            imageMutex.unlock();
+
+// Renders on its own thread so the event loop never waits for a frame. Each
+// submit() bumps the generation counter; the frame in progress polls it
+// before every tile and stops as soon as it is stale. The render threads only
+// compute iteration counts, plain and continuous; finished tiles are copied to
+// the shown counts and colored into a front buffer, which the UI thread
+// uploads whenever it presents. A palette or coloring change recolors the
+// shown counts without rendering, on the render thread between passes.
+// Histogram coloring equalizes over the counts of the last finished pass;
+// the table is built once per pass and color cycling only rotates it.
+class BackgroundRenderer {
+public:
+    // Outcome of the last finished pass, for the window title
+    struct Status {
+        FrameResult result;
+        RenderMode renderMode = RenderMode::BruteForce;
+        int power = 2;
+        int step = 1;
+    };
+
+    BackgroundRenderer(int width, int height, int maxIterations)
+        : width(width), height(height), maxIterations(maxIterations), back(static_cast<size_t>(width) * height), shown(back.size()), backSmooth(back.size()),
+          shownSmooth(back.size()), front(back.size() * 4), spare(front.size()), histogram(static_cast<size_t>(maxIterations) + 1), paletteTable(makePaletteTable(palette, maxIterations)),
+          baseTable(paletteTable), thread(&BackgroundRenderer::renderLoop, this) {}
+
+    ~BackgroundRenderer() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+            ++generation;
         }
+        wake.notify_one();
+        thread.join();
+    }
+
+    BackgroundRenderer(const BackgroundRenderer&) = delete;
+    BackgroundRenderer& operator=(const BackgroundRenderer&) = delete;
+
+    // Render request instead of the frame in progress, coarse to fine when
+    // progressive is set. With panned set, pixel (x, y) of request is pixel
+    // (x + shiftX, y + shiftY) of the previous request, and a complete
+    // previous frame is shifted instead of rendered again.
+    void submit(const RenderRequest& request, bool progressive, bool panned, int shiftX, int shiftY) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            // Shifts of a job that never started add up
+            if (pending) {
+                panned = panned && pendingJob.panned;
+                shiftX += pendingJob.shiftX;
+                shiftY += pendingJob.shiftY;
+            }
+            pendingJob = {request, progressive, panned, shiftX, shiftY};
+            pending = true;
+            ++generation;
+        }
+        wake.notify_one();
+    }
+
+    // Color the shown frame and every later tile with palette, cycled by
+    // cycle entries. Only hands the change to the render thread, which
+    // recolors the frame once the pass in progress is done.
+    void setPalette(Palette newPalette, Coloring newColoring, int newCycle) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            palette = newPalette;
+            coloring = newColoring;
+            cycle = newCycle;
+            recolorPending = true;
+        }
+        wake.notify_one();
+    }
+
+    // Upload the pixels finished since the last call, if any
+    void present(sf::Texture& texture) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!dirty) return;
+        texture.update(front.data());
+        dirty = false;
+    }
+
+    // Status of a pass finished since the last call, if any
+    bool takeStatus(Status& status) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!statusChanged) return false;
+        status = lastStatus;
+        statusChanged = false;
+        return true;
     }
-}
+
+    // Nothing to render or recolor and nothing left to present
+    bool idle() {
+        std::lock_guard<std::mutex> lock(mutex);
+        return !pending && !recolorPending && !rendering && !dirty;
+    }
+
+private:
+    struct Job {
+        RenderRequest request;
+        bool progressive = true;
+        bool panned = false;
+        int shiftX = 0;
+        int shiftY = 0;
+    };
+
+    int width;
+    int height;
+    int maxIterations;
+    // Render workers live for the whole session and pull tiles every frame
+    MandelbrotRenderer renderer;
+    // Iteration counts written by the render threads, the finished ones and
+    // their RGBA colors shown to the UI
+    std::vector<int> back;
+    std::vector<int> shown;
+    std::vector<int> backSmooth;
+    std::vector<int> shownSmooth;
+    std::vector<sf::Uint8> front;
+    // Recolored frame, swapped with front once done
+    std::vector<sf::Uint8> spare;
+    // Counts of the shown frame, for histogram coloring
+    std::vector<std::uint64_t> histogram;
+    // Requested palette, coloring and cycle, and the table and coloring of
+    // the shown colors
+    Palette palette = Palette::Gradient;
+    Coloring coloring = Coloring::Smooth;
+    int cycle = 0;
+    PaletteTable paletteTable;
+    Coloring tableColoring = Coloring::Smooth;
+    // Uncycled table and what it was built from. Like histogram and spare,
+    // only the render thread uses these.
+    PaletteTable baseTable;
+    Palette basePalette = Palette::Gradient;
+    Coloring baseColoring = Coloring::Smooth;
+    bool histogramChanged = false;
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::atomic<std::uint64_t> generation{0};
+    Job pendingJob;
+    bool pending = false;
+    bool recolorPending = false;
+    bool rendering = false;
+    bool dirty = false;
+    bool stopping = false;
+    Status lastStatus;
+    bool statusChanged = false;
+    std::thread thread;
+
+    // Color count shown pixels from offset on, the mutex is held
+    void colorize(size_t offset, size_t count) {
+        if (tableColoring == Coloring::Smooth) {
+            colorizeSmoothIterations(shownSmooth.data() + offset, count, paletteTable, front.data() + 4 * offset);
+        } else {
+            colorizeIterations(shown.data() + offset, count, paletteTable, front.data() + 4 * offset);
+        }
+    }
+
+    // Show pixels [x0, x1) x [y0, y1) of the back buffers
+    void publish(int x0, int y0, int x1, int y1) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (int y = y0; y < y1; ++y) {
+            const size_t offset = static_cast<size_t>(y) * width + x0;
+            std::copy(back.begin() + offset, back.begin() + offset + (x1 - x0), shown.begin() + offset);
+            std::copy(backSmooth.begin() + offset, backSmooth.begin() + offset + (x1 - x0), shownSmooth.begin() + offset);
+            colorize(offset, x1 - x0);
+        }
+        dirty = true;
+    }
+
+    // Called on the render thread once the pass is published. The histogram
+    // of every pass is kept, so switching to histogram coloring recolors
+    // right away; in histogram coloring the whole frame is recolored with it.
+    // Only the render threads write the shown counts, so they are read
+    // without the lock.
+    void finishPass(const Job& job, const FrameResult& result, int step) {
+        histogram = renderer.iterationHistogram(shown.data(), shown.size(), maxIterations);
+        histogramChanged = true;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            recolorPending = recolorPending || coloring == Coloring::Histogram;
+            lastStatus = {result, job.request.renderMode, job.request.options.power, step};
+            statusChanged = true;
+        }
+        recolor();
+    }
+
+    // Recolor the shown frame after setPalette or a new histogram, on the
+    // render thread while no pass runs. The table is only built again for a
+    // new palette, coloring or histogram; cycling rotates it. The frame is
+    // colored into the spare buffer without the lock and then swapped in.
+    void recolor() {
+        Palette newPalette;
+        Coloring newColoring;
+        int newCycle = 0;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!recolorPending) return;
+            recolorPending = false;
+            newPalette = palette;
+            newColoring = coloring;
+            newCycle = cycle;
+        }
+        if (newPalette != basePalette || newColoring != baseColoring || (newColoring == Coloring::Histogram && histogramChanged)) {
+            baseTable = newColoring == Coloring::Histogram ? makeEqualizedPaletteTable(newPalette, histogram) : makePaletteTable(newPalette, maxIterations);
+            basePalette = newPalette;
+            baseColoring = newColoring;
+            histogramChanged = false;
+        }
+        PaletteTable table = rotatePaletteTable(baseTable, newCycle);
+        if (newColoring == Coloring::Smooth) {
+            colorizeSmoothIterations(shownSmooth.data(), shownSmooth.size(), table, spare.data());
+        } else {
+            renderer.colorize(shown.data(), shown.size(), table, spare.data());
+        }
+        std::lock_guard<std::mutex> lock(mutex);
+        paletteTable = std::move(table);
+        tableColoring = newColoring;
+        front.swap(spare);
+        dirty = true;
+    }
+
+    void renderLoop() {
+        // Whether the back buffer holds the complete frame of the last job
+        bool frameComplete = false;
+        while (true) {
+            Job job;
+            std::uint64_t jobGeneration = 0;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&] { return pending || recolorPending || stopping; });
+                if (stopping) return;
+                if (!pending) {
+                    // Palette change only, rendering keeps idle() false until
+                    // the recolored frame is shown
+                    rendering = true;
+                    lock.unlock();
+                    recolor();
+                    lock.lock();
+                    rendering = false;
+                    continue;
+                }
+                job = std::move(pendingJob);
+                pending = false;
+                rendering = true;
+                jobGeneration = generation;
+            }
+            job.request.cancelled = [this, jobGeneration] { return generation != jobGeneration; };
+            job.request.tileDone = [this](int x0, int y0, int x1, int y1) { publish(x0, y0, x1, y1); };
+
+            if (job.panned && frameComplete) {
+                // Only the exposed strips are computed. The shown frame is
+                // shifted along first, so they are published over the
+                // shifted rest and not over the previous view.
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    MandelbrotRenderer::shiftFrame(width, height, job.shiftX, job.shiftY, shown.data(), front.data(), shownSmooth.data());
+                    dirty = true;
+                }
+                const FrameResult result = renderer.renderShifted(job.request, job.shiftX, job.shiftY, back.data(), nullptr, backSmooth.data());
+                frameComplete = !result.cancelled;
+                if (frameComplete) finishPass(job, result, 1);
+            } else {
+                // One pass per progressive step, or a single full resolution one
+                const int finalStep = 1;
+                int previousStep = 0;
+                frameComplete = false;
+                for (int step : progressiveSteps) {
+                    if (!job.progressive && step != finalStep) continue;
+                    const FrameResult result = renderer.renderPass(job.request, step, previousStep, back.data(), nullptr, backSmooth.data());
+                    if (result.cancelled) break;
+                    finishPass(job, result, step);
+                    previousStep = step;
+                    frameComplete = step == finalStep;
+                }
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            rendering = false;
+        }
+    }
+};
 
 int main() {
     const int width = 2560;
     const int height = 1440;
     const int maxIterations = 200;
+    // Kernel switches, e.g. turn interiorCheck off to benchmark the plain loop
+    KernelOptions kernelOptions;
     
     
     sf::RenderWindow window(sf::VideoMode(width, height), "Mandelbrot Set");
-    sf::Image image;
-    image.create(width, height, sf::Color(0, 0, 0));
+    // Present at most once per display refresh
+    window.setVerticalSyncEnabled(true);
+    // Renders behind the event loop, the texture shows what is done so far
+    BackgroundRenderer background(width, height, maxIterations);
+    // Palette and coloring on screen, color cycling position
+    Palette palette = Palette::Gradient;
+    Coloring coloring = Coloring::Smooth;
+    int cycle = 0;
     sf::Texture texture;
-    sf::Sprite sprite;
-    bool needRedraw = true;
+    texture.create(width, height);
+    sf::Sprite sprite(texture);
 
-    // Event manager
-    MandelbrotEventManager eventManager(1, {-0.5, 0});
+    // Event manager, owns the view: [-1.5, 0.5] x [-1, 1] initially
+    MandelbrotEventManager eventManager(Viewport{{-0.5, 0.0}, 2.0}, width, height);
+    const auto currentFrame = [&] {
+        RenderRequest frame;
+        frame.view = eventManager.getViewport();
+        frame.width = width;
+        frame.height = height;
+        frame.maxIterations = maxIterations;
+        frame.options = kernelOptions;
+        frame.options.power = eventManager.getPower();
+        frame.renderMode = eventManager.getRenderMode();
+        return frame;
+    };
+    background.submit(currentFrame(), eventManager.isProgressive(), false, 0, 0);
 
     while (window.isOpen()) {
-        eventManager.handleEvents(window);
-
-        if (needRedraw) {
-            const int threadCount = std::thread::hardware_concurrency();
-            std::vector<std::thread> threads;
-            int stripWidth = width / threadCount;
-
-            for (int i = 0; i < threadCount; ++i) {
-                int startX = i * stripWidth;
-                int endX = (i + 1) * stripWidth;
-                if (i == threadCount - 1) {
-                    endX = width; // Ensure the last strip covers the rest of the image
-                }
-                // Launch threads
-                threads.emplace_back(renderSection, std::ref(image), startX, endX, 0, height, eventManager.getZoom(), eventManager.getCenter(), maxIterations, width, height);
-            }
-
-            // Join threads
-            for (auto& t : threads) {
-               
-                t.join();
-            }
+        // Once the background renderer has nothing left to show this blocks
+        // until the next event, so an unchanged view costs no CPU time.
+        // A changed view cancels the frame in progress right away.
+        if (eventManager.handleEvents(window, background.idle() && !eventManager.isCycling())) {
+            int shiftX = 0;
+            int shiftY = 0;
+            const bool panned = eventManager.onlyPanned(shiftX, shiftY);
+            background.submit(currentFrame(), eventManager.isProgressive(), panned, shiftX, shiftY);
+        }
+        if (!window.isOpen()) break;
 
-            // After all threads complete, update the texture and sprite
-            texture.loadFromImage(image);
-            sprite.setTexture(texture);
+        // Recolor only, one step along the palette per display refresh while cycling
+        if (eventManager.getPalette() != palette || eventManager.getColoring() != coloring || eventManager.isCycling()) {
+            palette = eventManager.getPalette();
+            coloring = eventManager.getColoring();
+            cycle = eventManager.isCycling() ? cycle + 1 : cycle;
+            background.setPalette(palette, coloring, cycle);
+        }
 
-            //needRedraw = false; // Reset the flag as we've just redrawn
+        BackgroundRenderer::Status status;
+        if (background.takeStatus(status)) {
+            const FrameResult& result = status.result;
+            const KernelStats& frameStats = result.stats;
+            std::string title = "Mandelbrot Set (" + std::string(renderModeName(status.renderMode)) + ", " + precisionTierName(result.tier) + ", z^" +
+                                std::to_string(status.power) + (status.step > 1 ? ", 1/" + std::to_string(status.step) + " resolution" : "") +
+                                ") - cycle detection saved " + std::to_string(frameStats.iterationsSaved) + " iterations on " +
+                                std::to_string(frameStats.periodicPoints) + " points";
+            if (result.tier == PrecisionTier::Perturbation) {
+                title += " - deep zoom: " + std::to_string(result.references) + " references, " + std::to_string(frameStats.glitchedPoints) + " glitches, series skipped " +
+                         std::to_string(frameStats.seriesSkipped) + " iterations";
+            }
+            window.setTitle(title);
         }
 
+        // Present the tiles finished so far
+        background.present(texture);
         window.clear(sf::Color::Black);
         window.draw(sprite);
         window.display();
     }
 
     return 0;
-}
\ No newline at end of file
+}
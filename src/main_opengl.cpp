@@ -12,24 +12,36 @@
 
 
 // Local
+#include "../headers/double_double.hpp"
 #include "../headers/event_manager.hpp"
+#include "../headers/trace.hpp"
 #include "../headers/utils_shader.hpp"
 #include "../headers/utils.hpp"
+#include "../headers/mandelbrot_core.hpp"
+#include "../headers/mandelbrot_kernel.hpp"
 
 int main() {
     const int width = 1080;
     const int height = 720;
     const int maxIterations = 200;
+    // Cardioid / period-2 bulb pre-test in the shader, off to benchmark the plain loop
+    bool interiorCheck = true;
     float threshold = 2;
+    // Exponent of the shaders (their POWER define)
+    const int power = 2;
     sf::ContextSettings settings;
     settings.depthBits = 24;
     settings.stencilBits = 8;
-    settings.antialiasingLevel = 4;
+    // No multisampling: the cached frame is blitted to the window, which
+    // requires a single-sampled default framebuffer
+    settings.antialiasingLevel = 0;
     settings.majorVersion = 3;
     settings.minorVersion = 3;
     
     sf::RenderWindow window(sf::VideoMode(width, height), "OpenGL Mandelbrot Set", sf::Style::Default, settings);
     window.setActive(true);
+    // Present at most once per display refresh
+    window.setVerticalSyncEnabled(true);
 
     glewExperimental = GL_TRUE;
     GLenum err = glewInit();
@@ -76,89 +88,123 @@ int main() {
     }
     glUseProgram(shaderProgram); // Use the shader program
 
-    // ------------ create COMPLEX VALUES TEXTURE ----------------------------
-    float real_min = -2.0, real_max = 1.0, imag_min = -1.5, imag_max = 1.5;
-    std::vector<float> complex_set = gen_complex_set_2_shader(
-            width, height, real_min, real_max, imag_min, imag_max
-    );
-
-    GLuint tex_complex;
-    glGenTextures(1, &tex_complex);
-    glBindTexture(GL_TEXTURE_2D, tex_complex);
-    // GL_RG stores 2 values per pixel - Red, Green
-    // Red will store real part of complex number and Green - imaginary
-    glTexImage2D(
-            GL_TEXTURE_2D, 0, GL_RG32F, width, height, 0, GL_RG, GL_FLOAT, complex_set.data()
-    );
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    // -------------------------------------------------------------
-
     // --------------- create COLORMAP TEXTURE ------------------------------
-    int n_colors = 256;
-    std::vector<float> grayscale_colormap = generate_smooth_colormap(n_colors);
+    // One texel per iteration count, built once from the smooth colormap on
+    // the log scale the shader used to compute for every pixel
+    const PaletteTable colormap = makePaletteTable(Palette::Smooth, maxIterations);
 
     GLuint tex_colormap;
     glGenTextures(1, &tex_colormap);
     glBindTexture(GL_TEXTURE_1D, tex_colormap);
-    glTexImage1D(GL_TEXTURE_1D, 0, GL_RGB32F, n_colors, 0, GL_RGB, GL_FLOAT, grayscale_colormap.data());
+    glTexImage1D(GL_TEXTURE_1D, 0, GL_RGBA8, maxIterations + 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, colormap.colors.data());
     glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
     glTexParameteri(GL_TEXTURE_1D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
 
+    // --------------- create FRAME TEXTURE ---------------------------------
+    // The fractal is rendered into this texture only when the frame is dirty,
+    // every present just copies it to the window
+    GLuint tex_frame;
+    glGenTextures(1, &tex_frame);
+    glBindTexture(GL_TEXTURE_2D, tex_frame);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+    GLuint FBO;
+    glGenFramebuffers(1, &FBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, tex_frame, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Error creating the frame buffer" << "\n";
+        return -1;
+    }
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
     // ------------ get locations of dynamic uniform parameters
     GLint loc_threshold = glGetUniformLocation(shaderProgram, "threshold");
     GLint loc_n_iterations = glGetUniformLocation(shaderProgram, "n_iterations");
+    GLint loc_norm_scale = glGetUniformLocation(shaderProgram, "norm_scale");
+    GLint loc_power_scale = glGetUniformLocation(shaderProgram, "power_scale");
+    GLint loc_interior_check = glGetUniformLocation(shaderProgram, "interior_check");
+    GLint loc_periodicity_tolerance = glGetUniformLocation(shaderProgram, "periodicity_tolerance");
     GLint loc_colormap = glGetUniformLocation(shaderProgram, "colormap");
-    GLint loc_complex_set = glGetUniformLocation(shaderProgram, "complexSet");
+    GLint loc_view_center = glGetUniformLocation(shaderProgram, "view_center");
+    GLint loc_view_center_lo = glGetUniformLocation(shaderProgram, "view_center_lo");
+    GLint loc_float_float = glGetUniformLocation(shaderProgram, "float_float");
+    GLint loc_view_extent = glGetUniformLocation(shaderProgram, "view_extent");
+    GLint loc_view_rotation = glGetUniformLocation(shaderProgram, "view_rotation");
+    GLint loc_resolution = glGetUniformLocation(shaderProgram, "resolution");
 
 
-    // Event manager
-    MandelbrotEventManager eventManager(1, {-0.5, 0});
+    // Event manager, owns the view: [-2, 1] x [-1.5, 1.5] initially. The shader
+    // derives every pixel coordinate from the view uniforms.
+    MandelbrotEventManager eventManager(Viewport{{-0.5, 0.0}, 3.0});
 
-    int tex_unit_complex_set = 1;
     int tex_unit_colormap = 0;
 
-    while (window.isOpen()) {
-
-        // Handler user inputs (zoom and pan)
-        bool needRedraw = eventManager.handleEvents(window, complex_set);
+    // Set whenever the cached frame no longer matches the view
+    bool needRedraw = true;
 
-         // Print the needsRedraw value
-        std::cout << "Needs Redraw: " << (needRedraw ? "Yes" : "No") << std::endl;
+    while (window.isOpen()) {
 
+        // Handler user inputs (zoom and pan). While the cached frame is up to
+        // date this blocks until the next event instead of spinning.
+        needRedraw = eventManager.handleEvents(window, !needRedraw) || needRedraw;
+        if (!window.isOpen()) {
+            break;
+        }
 
-        // Render on the whole framebuffer, complete from the lower left corner to
-        // the upper right
-        glViewport(0, 0, width, height);
-        // Clear screen
-        glClear(GL_COLOR_BUFFER_BIT);
+        MANDELBROT_TRACE_LOG("Needs Redraw: " << (needRedraw ? "Yes" : "No"));
 
         if (needRedraw) {
-            glBindTexture(GL_TEXTURE_2D, tex_complex); // Bind the texture
-            glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RG, GL_FLOAT, complex_set.data());
-            glBindTexture(GL_TEXTURE_2D, 0); // Unbind the texture
+            const Viewport& view = eventManager.getViewport();
+
+            // Render on the whole frame texture, complete from the lower left corner to
+            // the upper right
+            glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+            glViewport(0, 0, width, height);
+            // Clear screen
+            glClear(GL_COLOR_BUFFER_BIT);
+
+            // Update uniform values based on user input
+            glUseProgram(shaderProgram);
+
+            glActiveTexture(GL_TEXTURE0 + tex_unit_colormap);
+            glBindTexture(GL_TEXTURE_1D, tex_colormap);
+            glUniform1i(loc_colormap, tex_unit_colormap);
+
+            glUniform1f(loc_threshold, threshold);
+            glUniform1i(loc_n_iterations, maxIterations);
+            // Continuous count constants, once per frame instead of per pixel
+            glUniform1f(loc_norm_scale, static_cast<float>(0.5 / std::log2(static_cast<double>(threshold))));
+            glUniform1f(loc_power_scale, static_cast<float>(1.0 / std::log2(static_cast<double>(power))));
+            glUniform1i(loc_interior_check, interiorCheck);
+            // Cycle detection tolerance follows the current pixel spacing
+            glUniform1f(loc_periodicity_tolerance, periodicityToleranceForSpacing(view.pixelSpacing(height)));
+            // View transform, replaces the per-pixel coordinate texture
+            // Float while it resolves the pixels, emulated float-float past that.
+            // The center is split into its nearest float and the remainder.
+            const bool floatFloat = !precisionCoversSpacing(floatRoundoff, view.pixelSpacing(height), view.center, maxIterations);
+            const float centerReal = static_cast<float>(view.center.real());
+            const float centerImag = static_cast<float>(view.center.imag());
+            glUniform1i(loc_float_float, floatFloat);
+            glUniform2f(loc_view_center, centerReal, centerImag);
+            glUniform2f(loc_view_center_lo, static_cast<float>(view.center.real() - centerReal), static_cast<float>(view.center.imag() - centerImag));
+            glUniform2f(loc_view_extent, view.realSpan(), view.imagSpan());
+            glUniform2f(loc_view_rotation, std::cos(view.rotation), std::sin(view.rotation));
+            glUniform2f(loc_resolution, width, height);
+
+            glBindVertexArray(VAO);
+
+            glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
+            needRedraw = false;
         }
 
-        // Update uniform values based on user input
-        glUseProgram(shaderProgram);
-
-        glActiveTexture(GL_TEXTURE0 + tex_unit_complex_set);
-        glBindTexture(GL_TEXTURE_2D, tex_complex);
-        glUniform1i(loc_complex_set, tex_unit_complex_set);
-
-        glActiveTexture(GL_TEXTURE0 + tex_unit_colormap);
-        glBindTexture(GL_TEXTURE_1D, tex_colormap);
-        glUniform1i(loc_colormap, tex_unit_colormap);
-
-        glUniform1f(loc_threshold, threshold);
-        glUniform1i(loc_n_iterations, maxIterations);
-
-        glBindVertexArray(VAO);
-
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
-            
+        // Present the cached frame
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, FBO);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+        glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_FRAMEBUFFER, 0);
         window.display();
 
     }
@@ -166,9 +212,10 @@ int main() {
     glDeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
     glDeleteBuffers(1, &EBO);
+    glDeleteFramebuffers(1, &FBO);
     glDeleteProgram(shaderProgram);
     // Delete textures
-    glDeleteTextures(1, &tex_complex);
     glDeleteTextures(1, &tex_colormap);
+    glDeleteTextures(1, &tex_frame);
     return 0;
 };
\ No newline at end of file
@@ -0,0 +1,272 @@
+#include <benchmark/benchmark.h>
+#include <cmath>
+#include <cstdint>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// Local
+#include "../headers/mandelbrot_core.hpp"
+
+// Micro and macro benchmarks of the rendering core. Names and arguments are
+// stable, so JSON results of two commits can be diffed directly:
+//     mandelbrot_bench --benchmark_format=json --benchmark_out=bench.json
+
+namespace {
+
+    // ---------------- escape-time kernel, one point per class -------------
+
+    void BM_IterationCount(benchmark::State& state, double real, double imag, bool interiorCheck) {
+        const int maxIterations = static_cast<int>(state.range(0));
+        KernelOptions options;
+        options.interiorCheck = interiorCheck;
+        int iterations = 0;
+        for (auto _ : state) {
+            // Hide the point from the optimizer, it must not fold the loop
+            benchmark::DoNotOptimize(real);
+            benchmark::DoNotOptimize(imag);
+            iterations = mandelbrotIterationCount(real, imag, maxIterations, options);
+            benchmark::DoNotOptimize(iterations);
+        }
+        state.counters["escape_iteration"] = iterations;
+    }
+    // Inside the main cardioid: decided by the closed-form test, or run to
+    // maxIterations without it
+    BENCHMARK_CAPTURE(BM_IterationCount, interior, -0.1, 0.1, true)->Arg(1000);
+    BENCHMARK_CAPTURE(BM_IterationCount, interior_no_check, -0.1, 0.1, false)->Arg(1000);
+    // Close to the boundary in the seahorse valley, escapes late
+    BENCHMARK_CAPTURE(BM_IterationCount, boundary, -0.743643887037151, 0.131825904205330, true)->Arg(1000);
+    // Far outside, escapes after a couple of iterations
+    BENCHMARK_CAPTURE(BM_IterationCount, fast_escape, 1.5, 1.5, true)->Arg(1000);
+
+    // Row of points across the boundary region, as renderSection feeds them
+    void fillBoundaryRow(std::vector<double>& real, std::vector<double>& imag) {
+        for (size_t i = 0; i < real.size(); ++i) {
+            real[i] = -0.75 + 0.01 * static_cast<double>(i) / real.size();
+            imag[i] = 0.1;
+        }
+    }
+
+    // Batched kernel per instruction set, range(1) is a KernelIsa
+    void BM_IterationCounts(benchmark::State& state) {
+        const int count = static_cast<int>(state.range(0));
+        const auto isa = static_cast<KernelIsa>(state.range(1));
+        if (isa > supportedKernelIsa()) {
+            state.SkipWithError("instruction set not supported by this CPU");
+            return;
+        }
+        const KernelIsa previousIsa = activeKernelIsa();
+        setKernelIsa(isa);
+        std::vector<double> real(count);
+        std::vector<double> imag(count);
+        std::vector<int> iterations(count);
+        fillBoundaryRow(real, imag);
+        for (auto _ : state) {
+            mandelbrotIterationCounts(real.data(), imag.data(), count, 1000, KernelOptions(), iterations.data());
+            benchmark::DoNotOptimize(iterations.data());
+        }
+        setKernelIsa(previousIsa);
+        state.SetLabel(kernelIsaName(isa));
+        state.SetItemsProcessed(state.iterations() * count);
+    }
+    BENCHMARK(BM_IterationCounts)->ArgsProduct({{1024}, {static_cast<int>(KernelIsa::Scalar), static_cast<int>(KernelIsa::AVX2), static_cast<int>(KernelIsa::AVX512)}});
+
+    // Compile-time kernel family, range(0) is a KernelScalar, range(1) the
+    // power and range(2) the escape radius
+    void BM_EscapeTimeKernel(benchmark::State& state) {
+        const auto scalar = static_cast<KernelScalar>(state.range(0));
+        const int power = static_cast<int>(state.range(1));
+        const int bailoutRadius = static_cast<int>(state.range(2));
+        const EscapeTimeKernel kernel = escapeTimeKernel(scalar, power, bailoutRadius);
+        const int count = 256;
+        std::vector<double> real(count);
+        std::vector<double> imag(count);
+        std::vector<int> iterations(count);
+        fillBoundaryRow(real, imag);
+        for (auto _ : state) {
+            kernel(DoubleDouble(), DoubleDouble(), real.data(), imag.data(), count, 1000, KernelOptions(), iterations.data(), nullptr, nullptr);
+            benchmark::DoNotOptimize(iterations.data());
+        }
+        state.SetLabel(kernelScalarName(scalar));
+        state.SetItemsProcessed(state.iterations() * count);
+    }
+    BENCHMARK(BM_EscapeTimeKernel)
+            ->ArgNames({"scalar", "power", "radius"})
+            ->ArgsProduct({{static_cast<int>(KernelScalar::Float), static_cast<int>(KernelScalar::Double), static_cast<int>(KernelScalar::LongDouble),
+                            static_cast<int>(KernelScalar::DoubleDouble)},
+                           {std::begin(kernelPowers), std::end(kernelPowers)},
+                           {std::begin(kernelBailoutRadii), std::end(kernelBailoutRadii)}});
+
+    // ---------------- coloring ---------------------------------------------
+
+    // Every iteration count of a frame with maxIterations = 1000 once
+    void BM_PaletteColor(benchmark::State& state) {
+        const auto palette = static_cast<Palette>(state.range(0));
+        const int maxIterations = 1000;
+        for (auto _ : state) {
+            for (int iteration = 0; iteration <= maxIterations; ++iteration) {
+                benchmark::DoNotOptimize(paletteColor(palette, iteration, maxIterations));
+            }
+        }
+        state.SetLabel(paletteName(palette));
+        state.SetItemsProcessed(state.iterations() * (maxIterations + 1));
+    }
+    BENCHMARK(BM_PaletteColor)->DenseRange(static_cast<int>(Palette::Gradient), static_cast<int>(Palette::Random));
+
+    // Table pass over a 1920x1080 iteration buffer, range(0) is a KernelIsa
+    void BM_ColorizeIterations(benchmark::State& state) {
+        const auto isa = static_cast<KernelIsa>(state.range(0));
+        if (isa > supportedKernelIsa()) {
+            state.SkipWithError("instruction set not supported by this CPU");
+            return;
+        }
+        const KernelIsa previousIsa = activeKernelIsa();
+        setKernelIsa(isa);
+        const int maxIterations = 1000;
+        const PaletteTable table = makePaletteTable(Palette::Smooth, maxIterations);
+        std::vector<int> iterations(1920 * 1080);
+        for (size_t i = 0; i < iterations.size(); ++i) {
+            iterations[i] = static_cast<int>((i * 7919) % (maxIterations + 1));
+        }
+        std::vector<std::uint8_t> pixels(iterations.size() * 4);
+        for (auto _ : state) {
+            colorizeIterations(iterations.data(), iterations.size(), table, pixels.data());
+            benchmark::DoNotOptimize(pixels.data());
+        }
+        setKernelIsa(previousIsa);
+        state.SetLabel(kernelIsaName(isa));
+        state.SetItemsProcessed(state.iterations() * iterations.size());
+    }
+    BENCHMARK(BM_ColorizeIterations)->Arg(static_cast<int>(KernelIsa::Scalar))->Arg(static_cast<int>(KernelIsa::AVX2));
+
+    // Same with continuous counts, blended between neighbouring table entries
+    void BM_ColorizeSmoothIterations(benchmark::State& state) {
+        const auto isa = static_cast<KernelIsa>(state.range(0));
+        if (isa > supportedKernelIsa()) {
+            state.SkipWithError("instruction set not supported by this CPU");
+            return;
+        }
+        const KernelIsa previousIsa = activeKernelIsa();
+        setKernelIsa(isa);
+        const int maxIterations = 1000;
+        const PaletteTable table = makePaletteTable(Palette::Smooth, maxIterations);
+        std::vector<int> smoothIterations(1920 * 1080);
+        for (size_t i = 0; i < smoothIterations.size(); ++i) {
+            smoothIterations[i] = static_cast<int>((i * 7919) % ((maxIterations << smoothFractionBits) + 1));
+        }
+        std::vector<std::uint8_t> pixels(smoothIterations.size() * 4);
+        for (auto _ : state) {
+            colorizeSmoothIterations(smoothIterations.data(), smoothIterations.size(), table, pixels.data());
+            benchmark::DoNotOptimize(pixels.data());
+        }
+        setKernelIsa(previousIsa);
+        state.SetLabel(kernelIsaName(isa));
+        state.SetItemsProcessed(state.iterations() * smoothIterations.size());
+    }
+    BENCHMARK(BM_ColorizeSmoothIterations)->Arg(static_cast<int>(KernelIsa::Scalar))->Arg(static_cast<int>(KernelIsa::AVX2));
+
+    // Histogram-equalized coloring of a finished 1920x1080 frame on every
+    // thread: partial histograms and their merge, the equalized table and the
+    // coloring pass. range(0) is maxIterations, i.e. the histogram size.
+    // Compare with BM_RenderFrame at the same size for its share of a frame.
+    void BM_HistogramColoring(benchmark::State& state) {
+        RenderRequest request;
+        request.view = Viewport{{-0.5, 0.0}, 2.4, 16.0 / 9.0};
+        request.width = 1920;
+        request.height = 1080;
+        request.maxIterations = static_cast<int>(state.range(0));
+        MandelbrotRenderer renderer;
+        const size_t pixelCount = static_cast<size_t>(request.width) * request.height;
+        std::vector<int> iterations(pixelCount);
+        std::vector<std::uint8_t> pixels(pixelCount * 4);
+        renderer.renderIterations(request, iterations.data());
+        for (auto _ : state) {
+            const PaletteTable table = makeEqualizedPaletteTable(Palette::Smooth, renderer.iterationHistogram(iterations.data(), pixelCount, request.maxIterations));
+            renderer.colorize(iterations.data(), pixelCount, table, pixels.data());
+            benchmark::DoNotOptimize(pixels.data());
+        }
+        state.SetLabel(std::to_string(renderer.threadCount()) + " threads");
+        state.SetItemsProcessed(state.iterations() * pixelCount);
+    }
+    BENCHMARK(BM_HistogramColoring)->Arg(200)->Arg(1000)->Arg(100000)->Unit(benchmark::kMillisecond)->UseRealTime();
+
+    // ---------------- view transform ---------------------------------------
+    // (Viewport replaced the per-pixel coordinate set and the complex_set_*
+    // view adjusters, these are its equivalents)
+
+    void BM_ViewportToComplex(benchmark::State& state) {
+        Viewport view{{-0.5, 0.0}, 2.0, 16.0 / 9.0, 0.3};
+        const int width = 1920;
+        const int height = 1080;
+        for (auto _ : state) {
+            for (int x = 0; x < width; ++x) {
+                benchmark::DoNotOptimize(view.toComplex((x + 0.5) / width, 0.5 / height));
+            }
+        }
+        state.SetItemsProcessed(state.iterations() * width);
+    }
+    BENCHMARK(BM_ViewportToComplex);
+
+    // One coalesced pan and zoom per frame, range(0) is -log10 of the span:
+    // deep views keep their exact center in BigFixed
+    void BM_ViewChangeApply(benchmark::State& state) {
+        Viewport view{{-0.743643887037151, 0.131825904205330}, std::pow(10.0, -static_cast<double>(state.range(0)))};
+        ViewChange change;
+        change.panReal = 0.01;
+        change.panImag = -0.01;
+        for (auto _ : state) {
+            change.applyTo(view);
+            benchmark::DoNotOptimize(view.center);
+        }
+    }
+    BENCHMARK(BM_ViewChangeApply)->Arg(0)->Arg(30)->Arg(100);
+
+    // ---------------- full frames ------------------------------------------
+
+    // range: width, height, maxIterations, threads (0 = all), RenderMode
+    void BM_RenderFrame(benchmark::State& state) {
+        RenderRequest request;
+        request.view = Viewport{{-0.5, 0.0}, 2.4, 16.0 / 9.0};
+        request.width = static_cast<int>(state.range(0));
+        request.height = static_cast<int>(state.range(1));
+        request.maxIterations = static_cast<int>(state.range(2));
+        request.renderMode = static_cast<RenderMode>(state.range(4));
+        MandelbrotRenderer renderer(static_cast<unsigned>(state.range(3)));
+        std::vector<std::uint8_t> pixels(static_cast<size_t>(request.width) * request.height * 4);
+        for (auto _ : state) {
+            renderer.render(request, pixels.data());
+            benchmark::DoNotOptimize(pixels.data());
+        }
+        state.SetLabel(std::string(renderModeName(request.renderMode)) + ", " + std::to_string(renderer.threadCount()) + " threads");
+        state.SetItemsProcessed(state.iterations() * request.width * request.height);
+    }
+    BENCHMARK(BM_RenderFrame)
+            ->ArgNames({"width", "height", "iterations", "threads", "mode"})
+            ->ArgsProduct({{640}, {360}, {200, 1000}, {1, 0}, {static_cast<int>(RenderMode::BruteForce), static_cast<int>(RenderMode::Subdivision)}})
+            ->Args({1920, 1080, 200, 0, static_cast<int>(RenderMode::BruteForce)})
+            ->Args({1920, 1080, 1000, 0, static_cast<int>(RenderMode::BruteForce)})
+            ->Unit(benchmark::kMillisecond)
+            ->UseRealTime();
+
+    // Perturbation frame: reference orbit, series approximation, glitch fixing
+    void BM_RenderDeepZoom(benchmark::State& state) {
+        RenderRequest request;
+        request.view = Viewport{{-0.743643887037151, 0.131825904205330}, std::pow(10.0, -static_cast<double>(state.range(0))), 16.0 / 9.0};
+        request.width = 640;
+        request.height = 360;
+        request.maxIterations = 2000;
+        MandelbrotRenderer renderer;
+        std::vector<std::uint8_t> pixels(static_cast<size_t>(request.width) * request.height * 4);
+        FrameResult result;
+        for (auto _ : state) {
+            result = renderer.render(request, pixels.data());
+            benchmark::DoNotOptimize(pixels.data());
+        }
+        state.SetLabel(precisionTierName(result.tier));
+        state.counters["references"] = result.references;
+        state.SetItemsProcessed(state.iterations() * request.width * request.height);
+    }
+    BENCHMARK(BM_RenderDeepZoom)->Arg(14)->Arg(20)->Unit(benchmark::kMillisecond)->UseRealTime();
+}
+
+BENCHMARK_MAIN();
@@ -0,0 +1,76 @@
+#include <algorithm>
+#include <thread>
+
+// Local
+#include "../headers/cpu_renderer.hpp"
+#include "../headers/mandelbrot_core.hpp"
+
+namespace {
+
+    FrameParams frameParams(const RenderRequest& request) {
+        FrameParams frame{request.view, std::min(request.maxIterations, maxSmoothIterations), request.options, request.width, request.height, request.palette};
+        frame.coloring = request.coloring;
+        frame.perturbation = request.perturbation;
+        frame.cancelled = request.cancelled;
+        frame.tileDone = request.tileDone;
+        return frame;
+    }
+}
+
+MandelbrotRenderer::MandelbrotRenderer(unsigned threadCount)
+    : pool(std::make_unique<TileThreadPool>(threadCount > 0 ? threadCount : std::thread::hardware_concurrency())) {}
+
+MandelbrotRenderer::~MandelbrotRenderer() = default;
+
+unsigned MandelbrotRenderer::threadCount() const {
+    return pool->size();
+}
+
+FrameResult MandelbrotRenderer::render(const RenderRequest& request, std::uint8_t* rgba) {
+    return renderIterations(request, nullptr, rgba);
+}
+
+FrameResult MandelbrotRenderer::renderIterations(const RenderRequest& request, int* iterations, std::uint8_t* rgba, int* smoothIterations) {
+    FrameParams frame = frameParams(request);
+    FrameTarget target;
+    target.rgba = rgba;
+    target.iterations = iterations;
+    target.smoothIterations = smoothIterations;
+    return renderFrame(*pool, target, frame, request.renderMode);
+}
+
+FrameResult MandelbrotRenderer::renderPass(const RenderRequest& request, int step, int previousStep, int* iterations, std::uint8_t* rgba, int* smoothIterations) {
+    FrameParams frame = frameParams(request);
+    frame.sampleStep = step;
+    frame.previousStep = previousStep;
+    FrameTarget target;
+    target.rgba = rgba;
+    target.iterations = iterations;
+    target.smoothIterations = smoothIterations;
+    return renderFrame(*pool, target, frame, request.renderMode);
+}
+
+FrameResult MandelbrotRenderer::renderShifted(const RenderRequest& request, int shiftX, int shiftY, int* iterations, std::uint8_t* rgba, int* smoothIterations) {
+    FrameParams frame = frameParams(request);
+    FrameTarget target;
+    target.rgba = rgba;
+    target.iterations = iterations;
+    target.smoothIterations = smoothIterations;
+    return renderFrame(*pool, target, frame, request.renderMode, ::shiftFrame(target, request.width, request.height, shiftX, shiftY));
+}
+
+void MandelbrotRenderer::shiftFrame(int width, int height, int shiftX, int shiftY, int* iterations, std::uint8_t* rgba, int* smoothIterations) {
+    FrameTarget target;
+    target.rgba = rgba;
+    target.iterations = iterations;
+    target.smoothIterations = smoothIterations;
+    ::shiftFrame(target, width, height, shiftX, shiftY);
+}
+
+std::vector<std::uint64_t> MandelbrotRenderer::iterationHistogram(const int* iterations, size_t count, int maxIterations) {
+    return ::iterationHistogram(*pool, iterations, count, maxIterations);
+}
+
+void MandelbrotRenderer::colorize(const int* iterations, size_t count, const PaletteTable& table, std::uint8_t* rgba) {
+    colorizeFrame(*pool, iterations, count, table, rgba);
+}
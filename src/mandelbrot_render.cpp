@@ -0,0 +1,303 @@
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Local
+#include "../headers/image_writer.hpp"
+#include "../headers/iteration_image.hpp"
+#include "../headers/mandelbrot_core.hpp"
+
+// Headless renderer: renders one view with the multithreaded CPU engine and
+// writes it to an image file. No window or GL context is created, so it runs
+// on machines without a display (e.g. batch render jobs).
+
+namespace {
+
+    // Command line settings, defaults show the whole set like the viewer
+    struct RenderSettings {
+        std::string centerReal = "-0.5";
+        std::string centerImag = "0";
+        // Magnification relative to the default view, whose span is 2
+        double zoom = 1.0;
+        int width = 1920;
+        int height = 1080;
+        int maxIterations = 200;
+        int power = 2;
+        unsigned threads = 0;
+        Palette palette = Palette::Gradient;
+        Coloring coloring = Coloring::Banded;
+        RenderMode renderMode = RenderMode::BruteForce;
+        bool interiorCheck = true;
+        // Vector kernel, the best one the CPU supports unless set
+        bool forceIsa = false;
+        KernelIsa isa = KernelIsa::Scalar;
+        std::string output = "mandelbrot.bmp";
+        // Golden image directories, at most one of them is set
+        std::string goldenRecord;
+        std::string goldenCheck;
+        // Fraction of pixels of a golden view that may differ
+        double tolerance = 0.0;
+    };
+
+    // Canonical views of the golden image set, small enough to check in seconds
+    struct GoldenView {
+        const char* name;
+        const char* centerReal;
+        const char* centerImag;
+        double zoom;
+        int maxIterations;
+    };
+
+    const GoldenView goldenViews[] = {
+        {"default", "-0.5", "0", 1.0, 200},
+        {"seahorse", "-0.743643887037151", "0.131825904205330", 1e4, 2000},
+        // Period 18 minibrot on the real axis, rendered by perturbation and
+        // recorded in double-double
+        {"minibrot", "-1.999999999784567530000312284146571281191144", "0", 4e19, 3000},
+    };
+    const int goldenWidth = 480;
+    const int goldenHeight = 270;
+
+    void printUsage(const char* program) {
+        std::cerr << "Usage: " << program << " [options]\n"
+                  << "  --center RE,IM      view center, decimal digits beyond double are kept (default -0.5,0)\n"
+                  << "  --zoom Z            magnification, the view spans 2 / Z (default 1)\n"
+                  << "  --size WxH          image size in pixels (default 1920x1080)\n"
+                  << "  --iterations N      maximum iteration count (default 200)\n"
+                  << "  --palette NAME      gradient, grayscale, smooth or random (default gradient)\n"
+                  << "  --coloring NAME     banded (one color per count), smooth or histogram (equalized\n"
+                  << "                      over the counts of the frame) (default banded)\n"
+                  << "  --power D           Multibrot exponent, 2 to 5 (default 2)\n"
+                  << "  --subdivision       render by Mariani-Silver subdivision\n"
+                  << "  --threads N         render threads (default: all cores)\n"
+                  << "  --no-interior-check run cardioid and bulb points through the kernel\n"
+                  << "  --isa NAME          vector kernel: scalar, avx2 or avx512 (default: best supported)\n"
+                  << "  --output FILE       .bmp or .ppm file (default mandelbrot.bmp)\n"
+                  << "  --golden-record DIR render the golden views with the plain paths (scalar, no\n"
+                  << "                      interior check, brute force, double-double instead of\n"
+                  << "                      perturbation) and store their iteration counts\n"
+                  << "  --golden-check DIR  render the golden views with the selected paths and compare\n"
+                  << "  --tolerance F       fraction of pixels per golden view allowed to differ (default 0)\n";
+    }
+
+    bool parsePositive(const std::string& text, int& value) {
+        char* end = nullptr;
+        const long parsed = std::strtol(text.c_str(), &end, 10);
+        if (end == text.c_str() || *end != '\0' || parsed <= 0 || parsed > 1000000) return false;
+        value = static_cast<int>(parsed);
+        return true;
+    }
+
+    // Returns false (after printing what is wrong) on invalid arguments
+    bool parseArguments(int argc, char** argv, RenderSettings& settings) {
+        for (int i = 1; i < argc; ++i) {
+            const std::string option = argv[i];
+            if (option == "--help") return false;
+            if (option == "--subdivision") {
+                settings.renderMode = RenderMode::Subdivision;
+                continue;
+            }
+            if (option == "--no-interior-check") {
+                settings.interiorCheck = false;
+                continue;
+            }
+            if (i + 1 >= argc) {
+                std::cerr << "Missing value for " << option << "\n";
+                return false;
+            }
+            const std::string value = argv[++i];
+            bool valid = true;
+            if (option == "--center") {
+                const size_t comma = value.find(',');
+                valid = comma != std::string::npos;
+                if (valid) {
+                    settings.centerReal = value.substr(0, comma);
+                    settings.centerImag = value.substr(comma + 1);
+                }
+            } else if (option == "--zoom") {
+                char* end = nullptr;
+                settings.zoom = std::strtod(value.c_str(), &end);
+                valid = end != value.c_str() && *end == '\0' && settings.zoom > 0.0;
+            } else if (option == "--size") {
+                const size_t x = value.find('x');
+                valid = x != std::string::npos && parsePositive(value.substr(0, x), settings.width) && parsePositive(value.substr(x + 1), settings.height);
+            } else if (option == "--iterations") {
+                // Continuous counts keep smoothFractionBits of fraction in an int
+                valid = parsePositive(value, settings.maxIterations) && settings.maxIterations <= maxSmoothIterations;
+            } else if (option == "--palette") {
+                valid = parsePalette(value, settings.palette);
+            } else if (option == "--coloring") {
+                valid = parseColoring(value, settings.coloring);
+            } else if (option == "--power") {
+                valid = parsePositive(value, settings.power) && escapeTimeKernel(KernelScalar::Double, settings.power, 2) != nullptr;
+            } else if (option == "--threads") {
+                int threads = 0;
+                valid = parsePositive(value, threads);
+                settings.threads = static_cast<unsigned>(threads);
+            } else if (option == "--isa") {
+                valid = false;
+                for (KernelIsa isa : {KernelIsa::Scalar, KernelIsa::AVX2, KernelIsa::AVX512}) {
+                    if (value == kernelIsaName(isa)) {
+                        settings.isa = isa;
+                        settings.forceIsa = valid = true;
+                    }
+                }
+            } else if (option == "--output") {
+                settings.output = value;
+            } else if (option == "--golden-record") {
+                settings.goldenRecord = value;
+            } else if (option == "--golden-check") {
+                settings.goldenCheck = value;
+            } else if (option == "--tolerance") {
+                char* end = nullptr;
+                settings.tolerance = std::strtod(value.c_str(), &end);
+                valid = end != value.c_str() && *end == '\0' && settings.tolerance >= 0.0 && settings.tolerance <= 1.0;
+            } else {
+                std::cerr << "Unknown option " << option << "\n";
+                return false;
+            }
+            if (!valid) {
+                std::cerr << "Invalid value for " << option << ": " << value << "\n";
+                return false;
+            }
+        }
+        if (!settings.goldenRecord.empty() && !settings.goldenCheck.empty()) {
+            std::cerr << "--golden-record and --golden-check exclude each other\n";
+            return false;
+        }
+        return true;
+    }
+
+    // View of the given size around a decimal center. The center is parsed in
+    // as many bits as the zoom or the given digits need.
+    bool makeView(const std::string& centerReal, const std::string& centerImag, double zoom, int width, int height, Viewport& view) {
+        view = Viewport{{0.0, 0.0}, 2.0 / zoom, static_cast<double>(width) / height};
+        const size_t digits = std::max(centerReal.size(), centerImag.size());
+        const int fractionLimbs = std::max(fractionLimbsForSpacing(view.pixelSpacing(height)), static_cast<int>(digits * 3.33 / 32) + 2);
+        BigComplex center;
+        if (!BigFixed::fromDecimal(centerReal, fractionLimbs, center.real) || !BigFixed::fromDecimal(centerImag, fractionLimbs, center.imag)) {
+            std::cerr << "Invalid value for --center: " << centerReal << "," << centerImag << "\n";
+            return false;
+        }
+        view.setExactCenter(center);
+        return true;
+    }
+
+    // Render every golden view to iteration counts and either store them in
+    // the directory or compare them against the stored ones. Returns the exit
+    // code, 1 when a view differs in more pixels than the tolerance allows.
+    int runGolden(const RenderSettings& settings) {
+        const bool record = !settings.goldenRecord.empty();
+        const std::string& directory = record ? settings.goldenRecord : settings.goldenCheck;
+        // The reference is what the plain paths produce, with deep views
+        // iterated directly in double-double instead of by perturbation
+        if (record) {
+            setKernelIsa(KernelIsa::Scalar);
+        } else if (settings.forceIsa) {
+            setKernelIsa(settings.isa);
+        }
+        MandelbrotRenderer renderer(settings.threads);
+        bool passed = true;
+        for (const GoldenView& golden : goldenViews) {
+            RenderRequest request;
+            if (!makeView(golden.centerReal, golden.centerImag, golden.zoom, goldenWidth, goldenHeight, request.view)) return 1;
+            request.width = goldenWidth;
+            request.height = goldenHeight;
+            request.maxIterations = golden.maxIterations;
+            request.options.interiorCheck = !record && settings.interiorCheck;
+            request.renderMode = record ? RenderMode::BruteForce : settings.renderMode;
+            request.perturbation = !record;
+
+            IterationImage image;
+            image.width = goldenWidth;
+            image.height = goldenHeight;
+            image.maxIterations = golden.maxIterations;
+            image.iterations.resize(static_cast<size_t>(goldenWidth) * goldenHeight);
+            const FrameResult result = renderer.renderIterations(request, image.iterations.data());
+
+            const std::string path = directory + "/" + golden.name + ".mitr";
+            if (record) {
+                if (!writeIterationImage(path, image)) return 1;
+                std::cout << "Recorded " << path << " (" << precisionTierName(result.tier) << ")\n";
+                continue;
+            }
+            IterationImage expected;
+            if (!readIterationImage(path, expected)) return 1;
+            if (expected.width != image.width || expected.height != image.height || expected.maxIterations != image.maxIterations) {
+                std::cerr << path << " was recorded with other settings, record it again\n";
+                return 1;
+            }
+            const IterationDiff diff = compareIterationImages(expected, image);
+            const double fraction = static_cast<double>(diff.differingPixels) / diff.totalPixels;
+            const bool withinTolerance = fraction <= settings.tolerance;
+            passed = passed && withinTolerance;
+            std::cout << (withinTolerance ? "PASS " : "FAIL ") << golden.name << " (" << precisionTierName(result.tier) << "): " << diff.differingPixels << " of "
+                      << diff.totalPixels << " pixels differ (" << fraction * 100.0 << "%)\n";
+            if (diff.differingPixels > 0) {
+                std::cout << "  max difference " << diff.maxDifference << " iterations, within x " << diff.minX << ".." << diff.maxX << ", y " << diff.minY << ".."
+                          << diff.maxY << "; first at (" << diff.firstX << ", " << diff.firstY << "): expected " << diff.firstExpected << ", got "
+                          << diff.firstActual << "\n";
+            }
+        }
+        if (!record) {
+            std::cout << (passed ? "Golden images match" : "Golden images differ") << " (" << kernelIsaName(activeKernelIsa()) << ", "
+                      << renderModeName(settings.renderMode) << ", interior check " << (settings.interiorCheck ? "on" : "off") << ")\n";
+        }
+        return passed ? 0 : 1;
+    }
+}
+
+int main(int argc, char** argv) {
+    RenderSettings settings;
+    if (!parseArguments(argc, argv, settings)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    if (!settings.goldenRecord.empty() || !settings.goldenCheck.empty()) {
+        return runGolden(settings);
+    }
+    if (settings.forceIsa) setKernelIsa(settings.isa);
+
+    Viewport view;
+    if (!makeView(settings.centerReal, settings.centerImag, settings.zoom, settings.width, settings.height, view)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    RenderRequest request;
+    request.view = view;
+    request.width = settings.width;
+    request.height = settings.height;
+    request.maxIterations = settings.maxIterations;
+    request.options.power = settings.power;
+    request.options.interiorCheck = settings.interiorCheck;
+    request.palette = settings.palette;
+    request.coloring = settings.coloring;
+    request.renderMode = settings.renderMode;
+
+    MandelbrotRenderer renderer(settings.threads);
+    std::vector<std::uint8_t> pixels(static_cast<size_t>(settings.width) * settings.height * 4);
+
+    const auto start = std::chrono::steady_clock::now();
+    const FrameResult result = renderer.render(request, pixels.data());
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    if (!writeImage(settings.output, pixels.data(), settings.width, settings.height)) {
+        return 1;
+    }
+
+    const double megapixels = static_cast<double>(settings.width) * settings.height * 1e-6;
+    std::cout << "Rendered " << settings.width << "x" << settings.height << " (" << precisionTierName(result.tier) << ", " << renderModeName(settings.renderMode)
+              << ", " << coloringName(settings.coloring) << " coloring, " << renderer.threadCount() << " threads) in " << seconds << " s, " << megapixels / seconds << " Mpixel/s\n";
+    if (result.tier == PrecisionTier::Perturbation) {
+        std::cout << "Deep zoom: " << result.references << " references, " << result.stats.glitchedPoints << " glitches, series skipped "
+                  << result.stats.seriesSkipped << " iterations\n";
+    }
+    std::cout << "Wrote " << settings.output << "\n";
+    return 0;
+}
@@ -0,0 +1,286 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Local
+#include "../headers/cpu_renderer.hpp"
+#include "../headers/mandelbrot_core.hpp"
+
+// Regression tests of the rendering core, mostly against the exact BigFixed kernel.
+// One case per run, so CTest lists them separately: mandelbrot_tests <case>
+
+namespace {
+
+    const int testWidth = 48;
+    const int testHeight = 27;
+
+    // Pixels whose count differs from the exact kernel, and the largest difference
+    struct Mismatch {
+        int pixels = 0;
+        int maxDelta = 0;
+    };
+
+    // Small view around a decimal center, the span is 2 / zoom like in mandelbrot_render
+    RenderRequest testRequest(const std::string& centerReal, const std::string& centerImag, double zoom, int maxIterations) {
+        RenderRequest request;
+        request.view = Viewport{{0.0, 0.0}, 2.0 / zoom, static_cast<double>(testWidth) / testHeight};
+        const int fractionLimbs = std::max(fractionLimbsForSpacing(request.view.pixelSpacing(testHeight)), static_cast<int>(std::max(centerReal.size(), centerImag.size()) * 3.33 / 32) + 2);
+        BigComplex center;
+        BigFixed::fromDecimal(centerReal, fractionLimbs, center.real);
+        BigFixed::fromDecimal(centerImag, fractionLimbs, center.imag);
+        request.view.setExactCenter(center);
+        request.width = testWidth;
+        request.height = testHeight;
+        request.maxIterations = maxIterations;
+        return request;
+    }
+
+    // Iterates every pixel of the request at its exact coordinates in BigFixed
+    Mismatch compareWithExact(const RenderRequest& request, const std::vector<int>& iterations) {
+        const FrameParams frame{request.view, request.maxIterations, request.options, request.width, request.height};
+        const int fractionLimbs = fractionLimbsForSpacing(frame.pixelSpacing());
+        Mismatch mismatch;
+        for (int y = 0; y < request.height; ++y) {
+            for (int x = 0; x < request.width; ++x) {
+                const int exact = mandelbrotIterationCount(frame.exactPixel(x, y, fractionLimbs), request.maxIterations, request.options);
+                const int delta = std::abs(exact - iterations[y * request.width + x]);
+                if (delta == 0) continue;
+                ++mismatch.pixels;
+                mismatch.maxDelta = std::max(mismatch.maxDelta, delta);
+            }
+        }
+        return mismatch;
+    }
+
+    // Views on both sides of the switch from double to perturbation. The double
+    // tier has to hand over before its rounding errors reach the counts, which
+    // happens earlier the longer the orbits are.
+    bool tierBoundary() {
+        struct BoundaryView {
+            const char* centerReal;
+            const char* centerImag;
+            double zoom;
+            int maxIterations;
+            PrecisionTier tier;
+        };
+        // Misiurewicz point, its counts stay finite at any zoom
+        const char* misiurewiczReal = "-0.10109636384562";
+        const char* misiurewiczImag = "0.95628651080914";
+        // Seahorse valley, long orbits near a parabolic point
+        const char* seahorseReal = "-0.743643887037151";
+        const char* seahorseImag = "0.131825904205330";
+        // Near the antenna tip, where double runs out first at low iteration counts
+        const char* antennaReal = "-1.99999911758738";
+        const char* antennaImag = "0.000000001";
+        const BoundaryView views[] = {
+            {misiurewiczReal, misiurewiczImag, 1.5e7, 1000, PrecisionTier::Double},
+            {misiurewiczReal, misiurewiczImag, 3e7, 1000, PrecisionTier::Perturbation},
+            {misiurewiczReal, misiurewiczImag, 1e11, 1000, PrecisionTier::Perturbation},
+            {misiurewiczReal, misiurewiczImag, 5e8, 100, PrecisionTier::Double},
+            {misiurewiczReal, misiurewiczImag, 1e9, 100, PrecisionTier::Perturbation},
+            {antennaReal, antennaImag, 1e8, 200, PrecisionTier::Double},
+            {antennaReal, antennaImag, 2e8, 200, PrecisionTier::Perturbation},
+            {antennaReal, antennaImag, 1e10, 200, PrecisionTier::Perturbation},
+            {seahorseReal, seahorseImag, 6e6, 2000, PrecisionTier::Double},
+            {seahorseReal, seahorseImag, 9e6, 2000, PrecisionTier::Perturbation},
+            {seahorseReal, seahorseImag, 1e10, 2000, PrecisionTier::Perturbation},
+        };
+        // Escape times are chaotic along the boundary, up to about 1% of the
+        // seahorse pixels flip under any double rounding. Well above that
+        // means a tier ran out of digits (a stale switch gave 7%).
+        const int tolerance = testWidth * testHeight / 50;
+        MandelbrotRenderer renderer;
+        bool passed = true;
+        for (const BoundaryView& view : views) {
+            const RenderRequest request = testRequest(view.centerReal, view.centerImag, view.zoom, view.maxIterations);
+            std::vector<int> iterations(static_cast<size_t>(request.width) * request.height);
+            const FrameResult result = renderer.renderIterations(request, iterations.data());
+            const Mismatch mismatch = compareWithExact(request, iterations);
+            const bool viewPassed = result.tier == view.tier && mismatch.pixels <= tolerance;
+            std::cerr << (viewPassed ? "ok   " : "FAIL ") << view.centerReal << "," << view.centerImag << " zoom " << view.zoom
+                      << " iterations " << view.maxIterations << ": " << precisionTierName(result.tier)
+                      << " (expected " << precisionTierName(view.tier) << "), " << mismatch.pixels
+                      << " pixels differ from exact, max " << mismatch.maxDelta << "\n";
+            passed = passed && viewPassed;
+        }
+        return passed;
+    }
+
+    // Deep frames with the large escape radius. Perturbation, its series
+    // approximation and the glitch fallback all have to stop at R = 256 like
+    // the exact kernel does, or every count is off.
+    bool deepBailout() {
+        const char* minibrotReal = "-1.999999999784567530000312284146571281191144";
+        MandelbrotRenderer renderer;
+        bool passed = true;
+        for (int bailoutRadius : kernelBailoutRadii) {
+            for (double zoom : {1e14, 1e20}) {
+                RenderRequest request = testRequest(minibrotReal, "0", zoom, 3000);
+                request.options.bailoutRadius = bailoutRadius;
+                std::vector<int> iterations(static_cast<size_t>(request.width) * request.height);
+                const FrameResult result = renderer.renderIterations(request, iterations.data());
+                const Mismatch mismatch = compareWithExact(request, iterations);
+                // Every pixel of these views escapes well off the boundary
+                const bool viewPassed = result.tier == PrecisionTier::Perturbation && mismatch.pixels == 0;
+                std::cerr << (viewPassed ? "ok   " : "FAIL ") << "minibrot zoom " << zoom << " R=" << bailoutRadius << ": " << precisionTierName(result.tier) << ", "
+                          << mismatch.pixels << " pixels differ from exact, max " << mismatch.maxDelta << "\n";
+                passed = passed && viewPassed;
+            }
+        }
+        return passed;
+    }
+
+    // Points on and just off the real axis whose orbit lands just inside
+    // |z| = 256 with c below 1/2. The next step takes z past 65536, so the
+    // BigFixed kernel has to stop there before squaring it: the square
+    // wraps in the one integer limb and used to hide the escape.
+    bool exactBailout() {
+        KernelOptions options;
+        options.bailoutRadius = 256;
+        bool passed = true;
+        for (int steps = 7; steps <= 14; ++steps) {
+            // Real c whose orbit reaches 255.9999 after steps steps, bisected in double
+            const auto orbitAfter = [steps](double c) {
+                double z = c;
+                for (int i = 1; i < steps; ++i) z = z * z + c;
+                return z;
+            };
+            double low = 0.25;
+            double high = 1.0;
+            for (int i = 0; i < 100; ++i) {
+                const double middle = 0.5 * (low + high);
+                (orbitAfter(middle) < 255.9999 ? low : high) = middle;
+            }
+            for (double imag : {0.0, 1e-9}) {
+                BigComplex c;
+                c.real = BigFixed::fromDouble(low, 3);
+                c.imag = BigFixed::fromDouble(imag, 3);
+                const int exact = mandelbrotIterationCount(c, 1000, options);
+                const int expected = mandelbrotIterationCount(low, imag, 1000, options);
+                const bool pointPassed = exact == expected;
+                std::cerr << (pointPassed ? "ok   " : "FAIL ") << "c " << low << "+" << imag << "i R=256: exact " << exact << ", double " << expected << "\n";
+                passed = passed && pointPassed;
+            }
+        }
+        return passed;
+    }
+
+    // A pan that reuses the shifted last frame against a fresh render of the
+    // panned view. Both round the pixel coordinates from different centers,
+    // so counts that flip under a one-ulp change of c may differ.
+    bool panShift() {
+        struct PanView {
+            const char* centerReal;
+            const char* centerImag;
+            double zoom;
+            int maxIterations;
+            // Fraction of the pixels that may differ
+            double tolerance;
+        };
+        // The real axis is left out: the old frame may have a row exactly on
+        // it, which stays in the set, while a fresh row only comes within
+        // rounding of it and escapes
+        const PanView views[] = {
+            {"-0.5", "0.3", 1.0, 200, 0.0},
+            {"-0.10109636384562", "0.95628651080914", 1e5, 1000, 0.0},
+            {"-0.10109636384562", "0.95628651080914", 1e12, 1000, 0.0},
+            // Long chaotic orbits, about 0.4% of the pixels flip
+            {"-0.743643887037151", "0.131825904205330", 1e4, 2000, 0.005},
+        };
+        const int width = 320;
+        const int height = 180;
+        const size_t pixelCount = static_cast<size_t>(width) * height;
+        MandelbrotRenderer renderer;
+        bool passed = true;
+        for (const PanView& view : views) {
+            for (const auto& [panReal, panImag] : {std::pair(0.05, 0.0), std::pair(-0.13, 0.07)}) {
+                RenderRequest request = testRequest(view.centerReal, view.centerImag, view.zoom, view.maxIterations);
+                request.width = width;
+                request.height = height;
+                request.view.aspect = static_cast<double>(width) / height;
+                std::vector<int> shifted(pixelCount);
+                std::vector<std::uint8_t> shiftedRgba(pixelCount * 4);
+                renderer.renderIterations(request, shifted.data(), shiftedRgba.data());
+
+                ViewChange change;
+                change.panReal = panReal;
+                change.panImag = panImag;
+                const auto [shiftX, shiftY] = change.snapToPixels(request.view, width, height);
+                change.applyTo(request.view);
+                const FrameResult result = renderer.renderShifted(request, shiftX, shiftY, shifted.data(), shiftedRgba.data());
+                std::vector<int> fresh(pixelCount);
+                std::vector<std::uint8_t> freshRgba(pixelCount * 4);
+                renderer.renderIterations(request, fresh.data(), freshRgba.data());
+
+                int differing = 0;
+                int differingColors = 0;
+                for (size_t i = 0; i < pixelCount; ++i) {
+                    differing += shifted[i] != fresh[i];
+                    differingColors += std::memcmp(&shiftedRgba[i * 4], &freshRgba[i * 4], 4) != 0;
+                }
+                const int allowed = static_cast<int>(view.tolerance * pixelCount);
+                const bool viewPassed = differing <= allowed && differingColors <= allowed;
+                std::cerr << (viewPassed ? "ok   " : "FAIL ") << view.centerReal << "," << view.centerImag << " zoom " << view.zoom << " shift " << shiftX << ","
+                          << shiftY << ": " << precisionTierName(result.tier) << ", " << differing << " counts and " << differingColors << " colors of "
+                          << pixelCount << " differ from a fresh render (" << allowed << " allowed)\n";
+                passed = passed && viewPassed;
+            }
+        }
+        return passed;
+    }
+
+    // Color cycling rotates a built table instead of building it again. The
+    // rotation has to give the colors makePaletteTable gives for the cycle,
+    // with the interior color kept, also for negative and wrapping cycles.
+    bool paletteCycle() {
+        bool passed = true;
+        for (Palette palette : {Palette::Gradient, Palette::Smooth}) {
+            for (int maxIterations : {1, 200}) {
+                const PaletteTable base = makePaletteTable(palette, maxIterations);
+                for (int cycle : {0, 1, 57, maxIterations, 450, -3}) {
+                    const bool cyclePassed = rotatePaletteTable(base, cycle).colors == makePaletteTable(palette, maxIterations, cycle).colors;
+                    if (!cyclePassed) std::cerr << "FAIL " << paletteName(palette) << " iterations " << maxIterations << " cycle " << cycle << "\n";
+                    passed = passed && cyclePassed;
+                }
+            }
+        }
+        std::vector<std::uint64_t> histogram(201, 1);
+        histogram[200] = 50;
+        const PaletteTable equalized = makeEqualizedPaletteTable(Palette::Gradient, histogram);
+        const bool interiorKept = rotatePaletteTable(equalized, 77).colors.back() == equalized.colors.back();
+        std::cerr << (passed && interiorKept ? "ok   " : "FAIL ") << "rotated tables match cycled ones, interior color " << (interiorKept ? "kept" : "moved") << "\n";
+        return passed && interiorKept;
+    }
+
+    struct TestCase {
+        const char* name;
+        bool (*run)();
+    };
+
+    const TestCase testCases[] = {
+        {"tier_boundary", tierBoundary},
+        {"deep_bailout", deepBailout},
+        {"exact_bailout", exactBailout},
+        {"pan_shift", panShift},
+        {"palette_cycle", paletteCycle},
+    };
+
+}
+
+int main(int argc, char** argv) {
+    if (argc != 2) {
+        std::cerr << "Usage: " << argv[0] << " <case>\n";
+        for (const TestCase& testCase : testCases) std::cerr << "  " << testCase.name << "\n";
+        return 2;
+    }
+    for (const TestCase& testCase : testCases) {
+        if (argv[1] == std::string(testCase.name)) return testCase.run() ? 0 : 1;
+    }
+    std::cerr << "Unknown test case " << argv[1] << "\n";
+    return 2;
+}
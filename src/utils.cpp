@@ -0,0 +1,51 @@
+#include <random>
+#include <vector>
+
+// Local
+#include "../headers/utils.hpp"
+
+std::vector<float> generate_grayscale_colormap(int n_colors) {
+    std::vector<float> colormap(n_colors * 3); // *3 for RGB
+    for (int i = 0; i < n_colors; ++i) {
+        double intensity = static_cast<double>(i) / (n_colors - 1);
+        colormap[3 * i] = intensity;     // Red
+        colormap[3 * i + 1] = intensity; // Green
+        colormap[3 * i + 2] = intensity; // Blue
+    }
+    return colormap;
+}
+
+std::vector<float> generate_random_colormap(int n_colors) {
+    std::vector<float> colormap(n_colors*3);
+
+    const int fixed_seed = 12345;
+    std::mt19937 eng(fixed_seed);
+    std::uniform_real_distribution<> distr(0.0, 1.0);
+
+    for (int i = 0; i < n_colors; i++) {
+        double intensity = (static_cast<double>(i) * 2) / (n_colors - 1);
+        colormap[3 * i] = distr(eng) * intensity;
+        colormap[3 * i + 1] = distr(eng) * intensity;
+        colormap[3 * i + 2] = distr(eng) * intensity;
+    }
+
+    return colormap;
+}
+
+std::vector<float> generate_smooth_colormap(int n_colors) {
+    std::vector<float> colormap(n_colors * 3);
+
+    // Define start and end colors for the gradient
+    std::vector<double> startColor = {0.0f, 0.5f, 1.0}; // Blue
+    std::vector<double> endColor = {1.0f, 0.5f, 0.0f}; // Red
+
+    for (int i = 0; i < n_colors; i++) {
+        double ratio = static_cast<double>(i) / (n_colors - 1);
+        // Interpolate between startColor and endColor
+        colormap[3 * i] = startColor[0] + ratio * (endColor[0] - startColor[0]); // Red
+        colormap[3 * i + 1] = startColor[1] + ratio * (endColor[1] - startColor[1]); // Green
+        colormap[3 * i + 2] = startColor[2] + ratio * (endColor[2] - startColor[2]); // Blue
+    }
+
+    return colormap;
+}